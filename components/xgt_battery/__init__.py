@@ -1,9 +1,18 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome import pins
-from esphome.components import uart, sensor, text_sensor
+from esphome import automation, pins
+import esphome.final_validate as fv
+from esphome.core import CORE, ID
+from esphome.components import uart, sensor, binary_sensor, text_sensor, web_server_base
+from esphome.components.esp32 import add_idf_sdkconfig_option
 from esphome.const import (
     CONF_ID,
+    CONF_ADDRESS,
+    CONF_DURATION,
+    CONF_INTERVAL,
+    CONF_PAYLOAD,
+    CONF_STEP,
+    CONF_TRIGGER_ID,
     CONF_UPDATE_INTERVAL,
     DEVICE_CLASS_VOLTAGE,
     DEVICE_CLASS_TEMPERATURE, 
@@ -16,11 +25,22 @@ from esphome.const import (
     ICON_THERMOMETER,
     ICON_FLASH,
     ICON_CURRENT_AC,
+    ICON_TIMER,
+    ICON_PERCENT,
+    DEVICE_CLASS_CURRENT,
+    DEVICE_CLASS_PLUG,
+    ICON_COUNTER,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
     ENTITY_CATEGORY_DIAGNOSTIC,
 )
 
 CODEOWNERS = ["@your-username"]
 DEPENDENCIES = ["uart", "sensor", "text_sensor"]
+AUTO_LOAD = ["binary_sensor"]
+MULTI_CONF = True
+
+DOMAIN = "xgt_battery"
 
 CONF_BATTERY_VOLTAGE = "battery_voltage"
 CONF_BATTERY_TEMPERATURE = "battery_temperature"
@@ -33,13 +53,192 @@ CONF_CELL_VOLTAGE = "cell_voltage"
 CONF_MIN_CELL_VOLTAGE = "min_cell_voltage"
 CONF_MAX_CELL_VOLTAGE = "max_cell_voltage"
 CONF_CELL_DIVERGENCE = "cell_divergence"
+CONF_SLOW_INTERVAL = "slow_interval"
+CONF_STATIC_INTERVAL = "static_interval"
+CONF_POLL_CLASSES = "poll_classes"
+CONF_ADAPTIVE_TIMING = "adaptive_timing"
+CONF_TIMING_MARGIN = "timing_margin"
+CONF_RESPONSE_TIME = "response_time"
+CONF_RESPONSE_TIMEOUT = "response_timeout"
+CONF_COMMAND_GAP = "command_gap"
+CONF_CYCLE_TIME = "cycle_time"
+CONF_PROTOCOL_HEALTH = "protocol_health"
+CONF_TOTAL = "total"
+CONF_STRICT_CRC = "strict_crc"
+CONF_RETRY_BUDGET = "retry_budget"
+CONF_MAX_VALUE_AGE = "max_value_age"
+CONF_DEADBAND = "deadband"
+CONF_HEARTBEAT = "heartbeat"
+CONF_TRACE = "trace"
+CONF_TRACE_SIZE = "trace_size"
+CONF_FORMAT = "format"
+CONF_BATCH_READS = "batch_reads"
+CONF_SELECT_PIN = "select_pin"
+CONF_BUS_WAIT = "bus_wait"
+CONF_UART_ID = "uart_id"
+CONF_POLLING_TASK = "polling_task"
+CONF_CORE = "core"
+CONF_PRIORITY = "priority"
+CONF_ABSENT_BACKOFF = "absent_backoff"
+CONF_LIGHT_SLEEP = "light_sleep"
+CONF_ACTIVE_CURRENT = "active_current"
+CONF_IDLE_CURRENT = "idle_current"
+CONF_DUTY_CYCLE = "duty_cycle"
+CONF_AVERAGE_CURRENT = "average_current"
+CONF_PACK_CONNECTED = "pack_connected"
+CONF_REGISTERS = "registers"
+CONF_CELL = "cell"
+CONF_BATCH_SIZE = "batch_size"
+CONF_ON_CAPTURE = "on_capture"
+CONF_HISTORY = "history"
+CONF_RAW = "raw"
+CONF_MINUTE = "minute"
+CONF_QUARTER_HOUR = "quarter_hour"
+CONF_WEB_SERVER_BASE_ID = "web_server_base_id"
+CONF_ON_REGISTER_READ = "on_register_read"
+CONF_FRAME_TYPE = "frame_type"
+CONF_BYTE = "byte"
+CONF_FIRST = "first"
+CONF_LAST = "last"
 
 xgt_battery_ns = cg.esphome_ns.namespace("xgt_battery")
 XGTBattery = xgt_battery_ns.class_("XGTBattery", cg.Component, uart.UARTDevice)
+XGTBus = xgt_battery_ns.class_("XGTBus")
+PollClass = xgt_battery_ns.enum("PollClass")
+Register = xgt_battery_ns.enum("Register")
+HealthMetric = xgt_battery_ns.enum("HealthMetric")
+DumpTraceAction = xgt_battery_ns.class_("DumpTraceAction", automation.Action)
+StartCaptureAction = xgt_battery_ns.class_("StartCaptureAction", automation.Action)
+StopCaptureAction = xgt_battery_ns.class_("StopCaptureAction", automation.Action)
+CaptureSample = xgt_battery_ns.struct("CaptureSample")
+CaptureTrigger = xgt_battery_ns.class_(
+    "CaptureTrigger", automation.Trigger.template(cg.std_vector.template(CaptureSample))
+)
+XGTHistoryHandler = xgt_battery_ns.class_("XGTHistoryHandler", cg.Component)
+RegisterRead = xgt_battery_ns.struct("RegisterRead")
+RegisterReadTrigger = xgt_battery_ns.class_("RegisterReadTrigger", automation.Trigger.template(RegisterRead))
+ReadRegisterAction = xgt_battery_ns.class_("ReadRegisterAction", automation.Action)
+ScanRegistersAction = xgt_battery_ns.class_("ScanRegistersAction", automation.Action)
+StopScanAction = xgt_battery_ns.class_("StopScanAction", automation.Action)
+
+# Protocol instrumentation, chosen at compile time: per-byte VERBOSE logs, nothing, or a binary
+# ring of the last frames that is dumped on demand with xgt_battery.dump_trace
+TRACE_MODES = {
+    "none": None,
+    "log": "XGT_BATTERY_TRACE_LOG",
+    "ring": "XGT_BATTERY_TRACE_RING",
+}
+
+POLL_CLASSES = {
+    "static": PollClass.POLL_STATIC,
+    "slow": PollClass.POLL_SLOW,
+    "fast": PollClass.POLL_FAST,
+}
+
+# Registers whose poll class can be overridden, keyed by the sensor they feed
+REGISTERS = {
+    CONF_NUM_CHARGES: Register.REG_NUM_CHARGES,
+    CONF_CELL_SIZE: Register.REG_CELL_SIZE,
+    CONF_PARALLEL_COUNT: Register.REG_PARALLEL_COUNT,
+    CONF_BATTERY_HEALTH: Register.REG_BATTERY_HEALTH,
+    CONF_BATTERY_CHARGE: Register.REG_CHARGE,
+    CONF_BATTERY_TEMPERATURE: Register.REG_TEMPERATURE,
+    CONF_BATTERY_VOLTAGE: Register.REG_PACK_VOLTAGE,
+    CONF_CELL_VOLTAGE: Register.REG_CELL_VOLTAGES,
+}
+
+# Registers worth sampling at a high rate during a live capture, besides a cell
+CAPTURE_REGISTERS = {
+    key: REGISTERS[key] for key in [CONF_BATTERY_VOLTAGE, CONF_BATTERY_TEMPERATURE, CONF_BATTERY_CHARGE]
+}
+CAPTURE_WEAKEST_CELL = 0xFF
+
+def capture_cell(value):
+    """A cell number, or "weakest" for the lowest cell of the last reading"""
+    if isinstance(value, str) and value.lower() == "weakest":
+        return CAPTURE_WEAKEST_CELL
+    return cv.int_range(min=1, max=10)(value)
+
+# Register addresses (bytes 2..5 of a short command) and long frame payloads, as parsed by the component
+ADDRESS_LENGTH = 4
+MAX_PAYLOAD_LENGTH = 26
+
+def parse_hex_bytes(value):
+    """Hex bytes with optional separators between them, like C0 03 00 00, c0:03:00:00 or C0030000"""
+    data = b""
+    for token in value.replace(":", " ").replace("-", " ").split():
+        try:
+            data += bytes.fromhex(token)
+        except ValueError as err:
+            raise cv.Invalid(f"{value!r} is not a sequence of hex bytes") from err
+    return data
+
+def hex_bytes(length=None, max_length=None):
+    """Hex bytes, checked when given as a plain string; a lambda is checked on the device"""
+    def validator(value):
+        value = cv.string_strict(value)
+        data = parse_hex_bytes(value)
+        if length is not None and len(data) != length:
+            raise cv.Invalid(f"Expected {length} hex bytes, got {len(data)}")
+        if max_length is not None and len(data) > max_length:
+            raise cv.Invalid(f"Expected at most {max_length} hex bytes, got {len(data)}")
+        return value
+    return validator
+
+def validate_scan_range(config):
+    if config[CONF_FIRST] > config[CONF_LAST]:
+        raise cv.Invalid(f"{CONF_FIRST} must not be above {CONF_LAST}")
+    return config
+
+# Every battery sensor accepts deadband/heartbeat: publish only on a change larger than the
+# deadband, and at least once per heartbeat. Without either it publishes every cycle.
+PUBLISH_POLICY_SCHEMA = cv.Schema({
+    cv.Optional(CONF_DEADBAND): cv.positive_float,
+    cv.Optional(CONF_HEARTBEAT): cv.positive_time_period_milliseconds,
+})
+
+def battery_sensor_schema(**kwargs):
+    return sensor.sensor_schema(**kwargs).extend(PUBLISH_POLICY_SCHEMA)
+
+async def new_battery_sensor(var, config):
+    sens = await sensor.new_sensor(config)
+    if CONF_DEADBAND in config or CONF_HEARTBEAT in config:
+        cg.add(var.set_publish_policy(sens, config.get(CONF_DEADBAND, 0.0), config.get(CONF_HEARTBEAT, 0)))
+    return sens
+
+# Acquisition in its own FreeRTOS task, pinned to a core; loop() only publishes finished cycles
+POLLING_TASK_SCHEMA = cv.All(
+    cv.Schema({
+        cv.Optional(CONF_CORE, default=1): cv.int_range(min=0, max=1),
+        cv.Optional(CONF_PRIORITY, default=5): cv.int_range(min=1, max=20),
+    }),
+    cv.only_on_esp32,
+)
+
+def validate_history_server(config):
+    if CONF_WEB_SERVER_BASE_ID not in config:
+        raise cv.Invalid("history is served over HTTP, add web_server to the configuration")
+    return config
+
+# Samples kept per resolution: every cycle, 1 minute and 15 minute averages, served by the web server
+HISTORY_SCHEMA = cv.All(
+    cv.Schema({
+        cv.GenerateID(): cv.declare_id(XGTHistoryHandler),
+        cv.OnlyWith(CONF_WEB_SERVER_BASE_ID, "web_server_base"): cv.use_id(web_server_base.WebServerBase),
+        cv.Optional(CONF_RAW, default=360): cv.int_range(min=0, max=4000),
+        cv.Optional(CONF_MINUTE, default=360): cv.int_range(min=0, max=4000),
+        cv.Optional(CONF_QUARTER_HOUR, default=96): cv.int_range(min=0, max=4000),
+    }),
+    validate_history_server,
+)
+
+POLL_CLASSES_SCHEMA = cv.Schema({
+    cv.Optional(key): cv.enum(POLL_CLASSES, lower=True) for key in REGISTERS
+})
 
 # Define cell voltage schema for up to 10 cells
 CELL_VOLTAGE_SCHEMA = cv.Schema({
-    cv.Optional(f"cell_{i+1}"): sensor.sensor_schema(
+    cv.Optional(f"cell_{i+1}"): battery_sensor_schema(
         unit_of_measurement=UNIT_VOLT,
         accuracy_decimals=3,
         device_class=DEVICE_CLASS_VOLTAGE,
@@ -49,6 +248,42 @@ CELL_VOLTAGE_SCHEMA = cv.Schema({
     ) for i in range(10)
 })
 
+TIMING_SENSOR_SCHEMA = battery_sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    icon=ICON_TIMER,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+COUNTER_SENSOR_SCHEMA = battery_sensor_schema(
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_TOTAL_INCREASING,
+    icon=ICON_COUNTER,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+# Counters since boot, then transaction latency over the last cycle
+HEALTH_METRICS = {
+    "success": (HealthMetric.HEALTH_SUCCESS, COUNTER_SENSOR_SCHEMA),
+    "crc_errors": (HealthMetric.HEALTH_CRC_ERRORS, COUNTER_SENSOR_SCHEMA),
+    "timeouts": (HealthMetric.HEALTH_TIMEOUTS, COUNTER_SENSOR_SCHEMA),
+    "retries": (HealthMetric.HEALTH_RETRIES, COUNTER_SENSOR_SCHEMA),
+    "short_frames": (HealthMetric.HEALTH_SHORT_FRAMES, COUNTER_SENSOR_SCHEMA),
+    "latency_min": (HealthMetric.HEALTH_LATENCY_MIN, TIMING_SENSOR_SCHEMA),
+    "latency_avg": (HealthMetric.HEALTH_LATENCY_AVG, TIMING_SENSOR_SCHEMA),
+    "latency_max": (HealthMetric.HEALTH_LATENCY_MAX, TIMING_SENSOR_SCHEMA),
+}
+
+HEALTH_SCHEMA = cv.Schema({
+    cv.Optional(key): schema for key, (_, schema) in HEALTH_METRICS.items()
+})
+
+# Health sensors for the whole bus (total) or a single register
+PROTOCOL_HEALTH_SCHEMA = cv.Schema({
+    cv.Optional(key): HEALTH_SCHEMA for key in [CONF_TOTAL, *REGISTERS]
+})
+
 def validate_uart_settings(config):
     """Validate that UART is configured correctly for XGT battery communication
     
@@ -72,55 +307,102 @@ def validate_uart_settings(config):
     # This function serves as documentation of requirements and best practices
     return config
 
+def final_validate_shared_bus(config):
+    """Packs on the same UART take turns on the bus; each needs a select_pin to switch its line in"""
+    packs = fv.full_config.get().get(DOMAIN, [])
+    shared = [pack for pack in packs if pack[CONF_UART_ID] == config[CONF_UART_ID]]
+    if len(shared) > 1 and CONF_SELECT_PIN not in config:
+        raise cv.Invalid(
+            f"{len(shared)} packs share UART '{config[CONF_UART_ID]}', each of them needs a select_pin",
+            path=[CONF_SELECT_PIN],
+        )
+    return config
+
+def final_validate_trace(config):
+    """The trace mode is compiled in through a define, so it applies to every pack on the node"""
+    modes = {pack[CONF_TRACE] for pack in fv.full_config.get().get(DOMAIN, [])}
+    if len(modes) > 1:
+        raise cv.Invalid(
+            f"trace is set for all packs at once, use the same value on each (found {', '.join(sorted(modes))})",
+            path=[CONF_TRACE],
+        )
+    return config
+
+FINAL_VALIDATE_SCHEMA = cv.All(final_validate_shared_bus, final_validate_trace)
+
 CONFIG_SCHEMA = cv.All(
     cv.Schema({
         cv.GenerateID(): cv.declare_id(XGTBattery),
         cv.Optional(CONF_UPDATE_INTERVAL, default="10s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_SLOW_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_STATIC_INTERVAL, default="1h"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_CLASSES, default={}): POLL_CLASSES_SCHEMA,
+        cv.Optional(CONF_ADAPTIVE_TIMING, default=False): cv.boolean,
+        cv.Optional(CONF_TIMING_MARGIN, default="5ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_STRICT_CRC, default=False): cv.boolean,
+        cv.Optional(CONF_BATCH_READS, default=False): cv.boolean,
+        cv.Optional(CONF_RETRY_BUDGET, default=3): cv.int_range(min=0, max=20),
+        cv.Optional(CONF_MAX_VALUE_AGE): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_TRACE, default="log"): cv.one_of(*TRACE_MODES, lower=True),
+        cv.Optional(CONF_TRACE_SIZE, default=16): cv.int_range(min=1, max=255),
+        cv.Optional(CONF_SELECT_PIN): pins.gpio_output_pin_schema,
+        cv.Optional(CONF_POLLING_TASK): POLLING_TASK_SCHEMA,
+        cv.Optional(CONF_ABSENT_BACKOFF): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_LIGHT_SLEEP): cv.All(cv.boolean, cv.only_with_esp_idf),
+        cv.Optional(CONF_ACTIVE_CURRENT, default="40mA"): cv.current,
+        cv.Optional(CONF_IDLE_CURRENT, default="1mA"): cv.current,
+        cv.Optional(CONF_HISTORY): HISTORY_SCHEMA,
+        cv.Optional(CONF_ON_CAPTURE): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(CaptureTrigger),
+        }),
+        cv.Optional(CONF_ON_REGISTER_READ): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(RegisterReadTrigger),
+        }),
         
         # Main battery sensors
-        cv.Optional(CONF_BATTERY_VOLTAGE): sensor.sensor_schema(
+        cv.Optional(CONF_BATTERY_VOLTAGE): battery_sensor_schema(
             unit_of_measurement=UNIT_VOLT,
             accuracy_decimals=2,
             device_class=DEVICE_CLASS_VOLTAGE,
             state_class=STATE_CLASS_MEASUREMENT,
             icon=ICON_FLASH,
         ),
-        cv.Optional(CONF_BATTERY_TEMPERATURE): sensor.sensor_schema(
+        cv.Optional(CONF_BATTERY_TEMPERATURE): battery_sensor_schema(
             unit_of_measurement=UNIT_CELSIUS,
             accuracy_decimals=1,
             device_class=DEVICE_CLASS_TEMPERATURE,
             state_class=STATE_CLASS_MEASUREMENT,
             icon=ICON_THERMOMETER,
         ),
-        cv.Optional(CONF_BATTERY_CHARGE): sensor.sensor_schema(
+        cv.Optional(CONF_BATTERY_CHARGE): battery_sensor_schema(
             unit_of_measurement=UNIT_PERCENT,
             accuracy_decimals=0,
             device_class=DEVICE_CLASS_BATTERY,
             state_class=STATE_CLASS_MEASUREMENT,
             icon=ICON_BATTERY,
         ),
-        cv.Optional(CONF_BATTERY_HEALTH): sensor.sensor_schema(
+        cv.Optional(CONF_BATTERY_HEALTH): battery_sensor_schema(
             unit_of_measurement=UNIT_PERCENT,
             accuracy_decimals=0,
             state_class=STATE_CLASS_MEASUREMENT,
             icon=ICON_BATTERY,
             entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
-        cv.Optional(CONF_MIN_CELL_VOLTAGE): sensor.sensor_schema(
+        cv.Optional(CONF_MIN_CELL_VOLTAGE): battery_sensor_schema(
             unit_of_measurement=UNIT_VOLT,
             accuracy_decimals=3,
             device_class=DEVICE_CLASS_VOLTAGE,
             state_class=STATE_CLASS_MEASUREMENT,
             icon=ICON_FLASH,
         ),
-        cv.Optional(CONF_MAX_CELL_VOLTAGE): sensor.sensor_schema(
+        cv.Optional(CONF_MAX_CELL_VOLTAGE): battery_sensor_schema(
             unit_of_measurement=UNIT_VOLT,
             accuracy_decimals=3,
             device_class=DEVICE_CLASS_VOLTAGE,
             state_class=STATE_CLASS_MEASUREMENT,
             icon=ICON_FLASH,
         ),
-        cv.Optional(CONF_CELL_DIVERGENCE): sensor.sensor_schema(
+        cv.Optional(CONF_CELL_DIVERGENCE): battery_sensor_schema(
             unit_of_measurement=UNIT_VOLT,
             accuracy_decimals=3,
             device_class=DEVICE_CLASS_VOLTAGE,
@@ -128,26 +410,56 @@ CONFIG_SCHEMA = cv.All(
             icon=ICON_FLASH,
         ),
 
+        # On once a cycle got an answer, off when a pack stops answering
+        cv.Optional(CONF_PACK_CONNECTED): binary_sensor.binary_sensor_schema(
+            device_class=DEVICE_CLASS_PLUG,
+        ),
         
         # Diagnostic sensors
-        cv.Optional(CONF_NUM_CHARGES): sensor.sensor_schema(
+        cv.Optional(CONF_NUM_CHARGES): battery_sensor_schema(
             accuracy_decimals=0,
             state_class=STATE_CLASS_MEASUREMENT,
             icon=ICON_CURRENT_AC,
             entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
-        cv.Optional(CONF_CELL_SIZE): sensor.sensor_schema(
+        cv.Optional(CONF_CELL_SIZE): battery_sensor_schema(
             unit_of_measurement="mAh",
             accuracy_decimals=0,
             state_class=STATE_CLASS_MEASUREMENT,
             entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
-        cv.Optional(CONF_PARALLEL_COUNT): sensor.sensor_schema(
+        cv.Optional(CONF_PARALLEL_COUNT): battery_sensor_schema(
             accuracy_decimals=0,
             state_class=STATE_CLASS_MEASUREMENT,
             entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
         ),
         
+        # Learned bus timing (adaptive_timing)
+        cv.Optional(CONF_RESPONSE_TIME): TIMING_SENSOR_SCHEMA,
+        cv.Optional(CONF_RESPONSE_TIMEOUT): TIMING_SENSOR_SCHEMA,
+        cv.Optional(CONF_COMMAND_GAP): TIMING_SENSOR_SCHEMA,
+        
+        # Protocol health
+        cv.Optional(CONF_CYCLE_TIME): TIMING_SENSOR_SCHEMA,
+        cv.Optional(CONF_BUS_WAIT): TIMING_SENSOR_SCHEMA,
+        
+        # Power: share of time spent in cycles, and the average current it implies
+        cv.Optional(CONF_DUTY_CYCLE): battery_sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=2,
+            state_class=STATE_CLASS_MEASUREMENT,
+            icon=ICON_PERCENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_AVERAGE_CURRENT): battery_sensor_schema(
+            unit_of_measurement="mA",
+            accuracy_decimals=2,
+            device_class=DEVICE_CLASS_CURRENT,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_PROTOCOL_HEALTH, default={}): PROTOCOL_HEALTH_SCHEMA,
+        
         # Cell voltages
         cv.Optional(CONF_CELL_VOLTAGE): CELL_VOLTAGE_SCHEMA,
     })
@@ -161,56 +473,272 @@ async def to_code(config):
     await cg.register_component(var, config)
     await uart.register_uart_device(var, config)
     
+    # One bus object per UART, shared by every pack on it
+    buses = CORE.data.setdefault(DOMAIN, {})
+    uart_id = config[CONF_UART_ID]
+    if uart_id.id not in buses:
+        buses[uart_id.id] = cg.new_Pvariable(ID(f"{uart_id.id}_xgt_bus", is_declaration=True, type=XGTBus))
+    cg.add(var.set_bus(buses[uart_id.id]))
+    if CONF_SELECT_PIN in config:
+        pin = await cg.gpio_pin_expression(config[CONF_SELECT_PIN])
+        cg.add(var.set_select_pin(pin))
+    if CONF_ABSENT_BACKOFF in config:
+        cg.add(var.set_absent_backoff(config[CONF_ABSENT_BACKOFF]))
+    if config.get(CONF_LIGHT_SLEEP, False):
+        # Automatic light sleep needs power management and a tickless idle task
+        add_idf_sdkconfig_option("CONFIG_PM_ENABLE", True)
+        add_idf_sdkconfig_option("CONFIG_FREERTOS_USE_TICKLESS_IDLE", True)
+        cg.add_define("USE_XGT_BATTERY_LIGHT_SLEEP")
+        cg.add(var.set_light_sleep(True))
+    # Currents are configured in A, the estimate is in mA
+    cg.add(var.set_current_model(config[CONF_ACTIVE_CURRENT] * 1000, config[CONF_IDLE_CURRENT] * 1000))
+    if CONF_HISTORY in config:
+        history = config[CONF_HISTORY]
+        cg.add_define("USE_XGT_BATTERY_HISTORY")
+        cg.add(var.set_history(history[CONF_RAW], history[CONF_MINUTE], history[CONF_QUARTER_HOUR]))
+        base = await cg.get_variable(history[CONF_WEB_SERVER_BASE_ID])
+        handler = cg.new_Pvariable(history[CONF_ID], base, var, config[CONF_ID].id)
+        await cg.register_component(handler, history)
+    for conf in config.get(CONF_ON_CAPTURE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(cg.std_vector.template(CaptureSample), "x")], conf)
+    for conf in config.get(CONF_ON_REGISTER_READ, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(RegisterRead, "x")], conf)
+    if CONF_POLLING_TASK in config:
+        cg.add_define("USE_XGT_BATTERY_TASK")
+        task = config[CONF_POLLING_TASK]
+        cg.add(var.set_polling_task(task[CONF_CORE], task[CONF_PRIORITY]))
+    
     cg.add(var.set_update_interval(config[CONF_UPDATE_INTERVAL]))
+    cg.add(var.set_slow_interval(config[CONF_SLOW_INTERVAL]))
+    cg.add(var.set_static_interval(config[CONF_STATIC_INTERVAL]))
+    for key, poll_class in config[CONF_POLL_CLASSES].items():
+        cg.add(var.set_poll_class(REGISTERS[key], poll_class))
+    cg.add(var.set_adaptive_timing(config[CONF_ADAPTIVE_TIMING]))
+    cg.add(var.set_timing_margin(config[CONF_TIMING_MARGIN]))
+    cg.add(var.set_strict_crc(config[CONF_STRICT_CRC]))
+    cg.add(var.set_batch_reads(config[CONF_BATCH_READS]))
+    cg.add(var.set_retry_budget(config[CONF_RETRY_BUDGET]))
+    if CONF_MAX_VALUE_AGE in config:
+        cg.add(var.set_max_value_age(config[CONF_MAX_VALUE_AGE]))
+    if TRACE_MODES[config[CONF_TRACE]] is not None:
+        cg.add_define(TRACE_MODES[config[CONF_TRACE]])
+    cg.add(var.set_trace_size(config[CONF_TRACE_SIZE]))
     
     # Configure main battery sensors
     if CONF_BATTERY_VOLTAGE in config:
-        sens = await sensor.new_sensor(config[CONF_BATTERY_VOLTAGE])
+        sens = await new_battery_sensor(var, config[CONF_BATTERY_VOLTAGE])
         cg.add(var.set_battery_voltage_sensor(sens))
         
     if CONF_BATTERY_TEMPERATURE in config:
-        sens = await sensor.new_sensor(config[CONF_BATTERY_TEMPERATURE])
+        sens = await new_battery_sensor(var, config[CONF_BATTERY_TEMPERATURE])
         cg.add(var.set_battery_temperature_sensor(sens))
         
     if CONF_BATTERY_CHARGE in config:
-        sens = await sensor.new_sensor(config[CONF_BATTERY_CHARGE])
+        sens = await new_battery_sensor(var, config[CONF_BATTERY_CHARGE])
         cg.add(var.set_battery_charge_sensor(sens))
         
     if CONF_BATTERY_HEALTH in config:
-        sens = await sensor.new_sensor(config[CONF_BATTERY_HEALTH])
+        sens = await new_battery_sensor(var, config[CONF_BATTERY_HEALTH])
         cg.add(var.set_battery_health_sensor(sens))
         
     if CONF_MIN_CELL_VOLTAGE in config:
-        sens = await sensor.new_sensor(config[CONF_MIN_CELL_VOLTAGE])
+        sens = await new_battery_sensor(var, config[CONF_MIN_CELL_VOLTAGE])
         cg.add(var.set_min_cell_voltage_sensor(sens))
         
     if CONF_MAX_CELL_VOLTAGE in config:
-        sens = await sensor.new_sensor(config[CONF_MAX_CELL_VOLTAGE])
+        sens = await new_battery_sensor(var, config[CONF_MAX_CELL_VOLTAGE])
         cg.add(var.set_max_cell_voltage_sensor(sens))
         
     if CONF_CELL_DIVERGENCE in config:
-        sens = await sensor.new_sensor(config[CONF_CELL_DIVERGENCE])
+        sens = await new_battery_sensor(var, config[CONF_CELL_DIVERGENCE])
         cg.add(var.set_cell_divergence_sensor(sens))
 
         
+    if CONF_PACK_CONNECTED in config:
+        sens = await binary_sensor.new_binary_sensor(config[CONF_PACK_CONNECTED])
+        cg.add(var.set_pack_connected_binary_sensor(sens))
+        
     # Configure diagnostic sensors
     if CONF_NUM_CHARGES in config:
-        sens = await sensor.new_sensor(config[CONF_NUM_CHARGES])
+        sens = await new_battery_sensor(var, config[CONF_NUM_CHARGES])
         cg.add(var.set_num_charges_sensor(sens))
         
     if CONF_CELL_SIZE in config:
-        sens = await sensor.new_sensor(config[CONF_CELL_SIZE])
+        sens = await new_battery_sensor(var, config[CONF_CELL_SIZE])
         cg.add(var.set_cell_size_sensor(sens))
         
     if CONF_PARALLEL_COUNT in config:
-        sens = await sensor.new_sensor(config[CONF_PARALLEL_COUNT])
+        sens = await new_battery_sensor(var, config[CONF_PARALLEL_COUNT])
         cg.add(var.set_parallel_count_sensor(sens))
         
+    # Configure timing diagnostic sensors
+    if CONF_RESPONSE_TIME in config:
+        sens = await new_battery_sensor(var, config[CONF_RESPONSE_TIME])
+        cg.add(var.set_response_time_sensor(sens))
+        
+    if CONF_RESPONSE_TIMEOUT in config:
+        sens = await new_battery_sensor(var, config[CONF_RESPONSE_TIMEOUT])
+        cg.add(var.set_response_timeout_sensor(sens))
+        
+    if CONF_COMMAND_GAP in config:
+        sens = await new_battery_sensor(var, config[CONF_COMMAND_GAP])
+        cg.add(var.set_command_gap_sensor(sens))
+        
+    # Configure protocol health sensors
+    if CONF_CYCLE_TIME in config:
+        sens = await new_battery_sensor(var, config[CONF_CYCLE_TIME])
+        cg.add(var.set_cycle_time_sensor(sens))
+        
+    if CONF_BUS_WAIT in config:
+        sens = await new_battery_sensor(var, config[CONF_BUS_WAIT])
+        cg.add(var.set_bus_wait_sensor(sens))
+        
+    if CONF_DUTY_CYCLE in config:
+        sens = await new_battery_sensor(var, config[CONF_DUTY_CYCLE])
+        cg.add(var.set_duty_cycle_sensor(sens))
+        
+    if CONF_AVERAGE_CURRENT in config:
+        sens = await new_battery_sensor(var, config[CONF_AVERAGE_CURRENT])
+        cg.add(var.set_average_current_sensor(sens))
+        
+    for key, metrics in config[CONF_PROTOCOL_HEALTH].items():
+        reg = Register.REG_COUNT if key == CONF_TOTAL else REGISTERS[key]
+        for metric_key, metric_config in metrics.items():
+            sens = await new_battery_sensor(var, metric_config)
+            cg.add(var.set_health_sensor(reg, HEALTH_METRICS[metric_key][0], sens))
+        
     # Configure cell voltage sensors
     if CONF_CELL_VOLTAGE in config:
         cell_config = config[CONF_CELL_VOLTAGE]
         for i in range(10):
             cell_key = f"cell_{i+1}"
             if cell_key in cell_config:
-                sens = await sensor.new_sensor(cell_config[cell_key])
-                cg.add(var.set_cell_voltage_sensor(i, sens)) 
\ No newline at end of file
+                sens = await new_battery_sensor(var, cell_config[cell_key])
+                cg.add(var.set_cell_voltage_sensor(i, sens)) 
+
+
+@automation.register_action(
+    "xgt_battery.dump_trace",
+    DumpTraceAction,
+    cv.maybe_simple_value(
+        {
+            cv.GenerateID(): cv.use_id(XGTBattery),
+            cv.Optional(CONF_FORMAT, default="text"): cv.one_of("text", "binary", lower=True),
+        },
+        key=CONF_ID,
+    ),
+)
+async def dump_trace_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    cg.add(var.set_binary(config[CONF_FORMAT] == "binary"))
+    return var
+
+
+@automation.register_action(
+    "xgt_battery.start_capture",
+    StartCaptureAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(XGTBattery),
+            cv.Optional(CONF_DURATION, default="30s"): cv.templatable(cv.positive_time_period_milliseconds),
+            cv.Optional(CONF_REGISTERS, default=[CONF_BATTERY_VOLTAGE]): cv.ensure_list(
+                cv.one_of(*CAPTURE_REGISTERS, lower=True)
+            ),
+            cv.Optional(CONF_CELL): capture_cell,
+            cv.Optional(CONF_BATCH_SIZE, default=10): cv.int_range(min=1, max=100),
+        }
+    ),
+)
+async def start_capture_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    duration = await cg.templatable(config[CONF_DURATION], args, cg.uint32)
+    cg.add(var.set_duration(duration))
+    for key in config[CONF_REGISTERS]:
+        cg.add(var.add_register(CAPTURE_REGISTERS[key]))
+    if CONF_CELL in config:
+        cg.add(var.set_cell(config[CONF_CELL]))
+    cg.add(var.set_batch_size(config[CONF_BATCH_SIZE]))
+    return var
+
+
+@automation.register_action(
+    "xgt_battery.stop_capture",
+    StopCaptureAction,
+    cv.maybe_simple_value({cv.GenerateID(): cv.use_id(XGTBattery)}, key=CONF_ID),
+)
+async def stop_capture_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action(
+    "xgt_battery.read_register",
+    ReadRegisterAction,
+    cv.All(
+        cv.Schema(
+            {
+                cv.GenerateID(): cv.use_id(XGTBattery),
+                cv.Optional(CONF_ADDRESS): cv.templatable(hex_bytes(length=ADDRESS_LENGTH)),
+                cv.Optional(CONF_PAYLOAD): cv.templatable(hex_bytes(max_length=MAX_PAYLOAD_LENGTH)),
+                cv.Optional(CONF_FRAME_TYPE): cv.hex_uint8_t,
+            }
+        ),
+        cv.has_exactly_one_key(CONF_ADDRESS, CONF_PAYLOAD),
+        cv.has_none_or_all_keys(CONF_PAYLOAD, CONF_FRAME_TYPE),
+    ),
+)
+async def read_register_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    if CONF_ADDRESS in config:
+        request = await cg.templatable(config[CONF_ADDRESS], args, cg.std_string)
+    else:
+        request = await cg.templatable(config[CONF_PAYLOAD], args, cg.std_string)
+        cg.add(var.set_long_frame_type(config[CONF_FRAME_TYPE]))
+    cg.add(var.set_request(request))
+    return var
+
+
+@automation.register_action(
+    "xgt_battery.scan_registers",
+    ScanRegistersAction,
+    cv.All(
+        cv.Schema(
+            {
+                cv.GenerateID(): cv.use_id(XGTBattery),
+                cv.Required(CONF_ADDRESS): cv.templatable(hex_bytes(length=ADDRESS_LENGTH)),
+                cv.Optional(CONF_BYTE, default=2): cv.int_range(min=0, max=ADDRESS_LENGTH - 1),
+                cv.Optional(CONF_FIRST, default=0): cv.hex_uint8_t,
+                cv.Optional(CONF_LAST, default=0xFF): cv.hex_uint8_t,
+                cv.Optional(CONF_STEP, default=1): cv.int_range(min=1, max=255),
+                cv.Optional(CONF_INTERVAL, default="1s"): cv.templatable(cv.positive_time_period_milliseconds),
+            }
+        ),
+        validate_scan_range,
+    ),
+)
+async def scan_registers_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    address = await cg.templatable(config[CONF_ADDRESS], args, cg.std_string)
+    cg.add(var.set_address(address))
+    interval = await cg.templatable(config[CONF_INTERVAL], args, cg.uint32)
+    cg.add(var.set_interval(interval))
+    cg.add(var.set_range(config[CONF_BYTE], config[CONF_FIRST], config[CONF_LAST], config[CONF_STEP]))
+    return var
+
+
+@automation.register_action(
+    "xgt_battery.stop_scan",
+    StopScanAction,
+    cv.maybe_simple_value({cv.GenerateID(): cv.use_id(XGTBattery)}, key=CONF_ID),
+)
+async def stop_scan_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
@@ -3,113 +3,337 @@
 #include "esphome/core/hal.h"
 #include <string>
 #include <cstring>
+#include <cmath>
 #include "driver/uart.h"
+#ifdef USE_XGT_BATTERY_TASK
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+#if defined(USE_XGT_BATTERY_TASK) && defined(USE_ESP_IDF)
+#include "esphome/components/uart/uart_component_esp_idf.h"
+#endif
 
 namespace esphome {
 namespace xgt_battery {
 
 static const char *const TAG = "xgt_battery";
 
-// Protocol commands from the original C++ code
+// The polling task can sleep in the ESP-IDF UART driver while it waits for a response
+#if defined(USE_XGT_BATTERY_TASK) && defined(USE_ESP_IDF)
+#define XGT_BATTERY_RX_WAIT
+#endif
 
-const uint8_t XGTBattery::num_charges_cmd_[8] = {
-    0x33, 0xC8, 0x3, 0x0, 0x2A, 0x0, 0x0, 0xCC
-};
+// trace: log keeps the per-byte VERBOSE protocol dumps; with none or ring they are not compiled in at all
+#ifdef XGT_BATTERY_TRACE_LOG
+#define XGT_TRACE_LOGV(...) ESP_LOGV(TAG, __VA_ARGS__)
+#else
+#define XGT_TRACE_LOGV(...)
+#endif
 
-const uint8_t XGTBattery::cell_size_cmd_[8] = {
-    0x33, 0x27, 0xBB, 0x10, 0x0, 0x0, 0x0, 0xCC
-};
+// Capture rows closer together than this skip the wake byte, the pack is still awake from the previous row
+static const uint32_t CAPTURE_AWAKE_MS = 500;
 
-const uint8_t XGTBattery::parallel_cnt_cmd_[8] = {
-    0x33, 0x67, 0xBB, 0x50, 0x0, 0x0, 0x0, 0xCC
-};
+// read_register() and scan reads: bus idle time before each (unknown registers get the gap of the metadata
+// registers), requests queued at most, and scan reads added to one cycle at most
+static const uint32_t READ_GAP_MS = 100;
+static const uint8_t READ_QUEUE_MAX = 8;
+static const uint8_t SCAN_READS_PER_CYCLE = 4;
 
-const uint8_t XGTBattery::batt_health_cmd_[8] = {
-    0x33, 0xC4, 0x3, 0x0, 0x26, 0x0, 0x0, 0xCC
-};
+static_assert(AdaptiveTiming::SLOTS >= REG_COUNT, "adaptive timing needs a slot per register");
+static_assert(REG_READ >= AdaptiveTiming::SLOTS, "reads outside the register table have no timing slot");
 
-const uint8_t XGTBattery::charge_cmd_[8] = {
-    0x33, 0x13, 0x3, 0x80, 0x10, 0x0, 0x0, 0xCC
-};
+// Hex bytes with optional separators between them: "C0 03 00 00", "c0:03:00:00", "C0030000"
+static bool parse_hex_bytes(const std::string &text, std::vector<uint8_t> *bytes) {
+    int high = -1;
+    for (char c : text) {
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else if ((c == ' ' || c == ':' || c == '-') && high < 0) {
+            continue;
+        } else {
+            return false;
+        }
+        if (high < 0) {
+            high = digit;
+        } else {
+            bytes->push_back(high << 4 | digit);
+            high = -1;
+        }
+    }
+    return high < 0;
+}
 
-const uint8_t XGTBattery::temperature_cmd_[8] = {
-    0x33, 0x3B, 0x3, 0xC0, 0x58, 0x0, 0x0, 0xCC
+// Sensor of each register table row (xgt_registers.h)
+sensor::Sensor *XGTBattery::*const XGTBattery::REGISTER_SENSORS[REG_COUNT] = {
+    &XGTBattery::num_charges_sensor_,     &XGTBattery::cell_size_sensor_,
+    &XGTBattery::parallel_count_sensor_,  &XGTBattery::battery_health_sensor_,
+    &XGTBattery::battery_charge_sensor_,  &XGTBattery::battery_temperature_sensor_,
+    &XGTBattery::battery_voltage_sensor_, nullptr,
 };
 
-const uint8_t XGTBattery::pack_voltage_cmd_[8] = {
-    0x33, 0x43, 0x3, 0xC0, 0x0, 0x0, 0x0, 0xCC
-};
+void XGTBattery::setup() {
+    ESP_LOGCONFIG(TAG, "Setting up XGT Battery...");
+    this->timing_.set_margin_ms(this->timing_margin_);
+#ifdef XGT_BATTERY_TRACE_RING
+    this->trace_.init(this->trace_size_);
+#endif
+    this->compute_needed_registers_();
+#ifdef USE_XGT_BATTERY_HISTORY
+    this->history_.init(this->history_samples_[0], this->history_samples_[1], this->history_samples_[2]);
+#endif
+    if (this->select_pin_ != nullptr) {
+        this->select_pin_->setup();
+        this->select_pin_->digital_write(false);
+    }
+#ifdef USE_XGT_BATTERY_LIGHT_SLEEP
+    if (this->light_sleep_) {
+        // The UART needs the APB clock and no light sleep while a cycle runs; in between the chip may sleep
+        esp_pm_config_t pm_config;
+        if (esp_pm_get_configuration(&pm_config) == ESP_OK && !pm_config.light_sleep_enable) {
+            pm_config.light_sleep_enable = true;
+            if (esp_pm_configure(&pm_config) != ESP_OK) {
+                ESP_LOGW(TAG, "Could not enable automatic light sleep");
+            }
+        }
+        esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "xgt_battery", &this->pm_apb_lock_);
+        esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "xgt_battery", &this->pm_sleep_lock_);
+    }
+#endif
+    // No bus traffic here: the first cycle starts from loop() (or the polling task) as soon as the bus
+    // allows, and its wake and first command double as pack detection (pack_connected)
 
-const uint8_t XGTBattery::cell_voltages_cmd_[8] = {
-    0x33, 0x23, 0x03, 0xC0, 0x00, 0x0, 0x0, 0xCC
-};
+#ifdef XGT_BATTERY_RX_WAIT
+    this->uart_num_ = static_cast<uart::IDFUARTComponent *>(this->parent_)->get_hw_serial_number();
+#endif
+#ifdef USE_XGT_BATTERY_TASK
+    if (this->use_task_ &&
+        xTaskCreatePinnedToCore(&XGTBattery::polling_task_, "xgt_battery", 4096, this, this->task_priority_, nullptr,
+                                this->task_core_) != pdPASS) {
+        ESP_LOGE(TAG, "Could not start the polling task");
+        this->mark_failed();
+    }
+#endif
+}
 
-// Lookup table to reverse bit order (MSB to LSB conversion)
-const uint8_t XGTBattery::lookup_[16] = {
-    0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe, 
-    0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf
-};
+void XGTBattery::compute_needed_registers_() {
+    uint16_t registers = 0;
+    uint16_t cells = 0;
 
-void XGTBattery::setup() {
-    ESP_LOGCONFIG(TAG, "Setting up XGT Battery...");
-    
-    // DEBUGGING: Test basic UART connectivity
-    ESP_LOGV(TAG, "=== UART CONNECTIVITY TEST ===");
-    ESP_LOGV(TAG, "Checking if any bytes available during setup...");
-    uint8_t setup_available = this->available();
-    ESP_LOGV(TAG, "Bytes available during setup: %d", setup_available);
-    
-    // Test basic UART connectivity using ESPHome methods
-    ESP_LOGV(TAG, "Testing UART connectivity with ESPHome methods...");
-    uint8_t test_pattern = 0x55;
-    this->write(test_pattern);
-    this->flush();
-    
-    delay(50);  // Give time for any echo/response
-    uint8_t echo_length = 0;
-    uint8_t echo_buffer[10];
-    uint32_t start_time = millis();
-    
-    while (echo_length < 10 && (millis() - start_time) < 100) {  // 100ms timeout
-        if (this->available()) {
-            echo_buffer[echo_length] = this->read();
-            echo_length++;
-        } else {
-            delay(1);
+    for (uint8_t reg = 0; reg < REG_COUNT; reg++) {
+        if (REGISTER_SENSORS[reg] != nullptr && this->*REGISTER_SENSORS[reg] != nullptr) {
+            registers |= (1 << reg) | REGISTERS[reg].depends_on;
         }
     }
-    
-    ESP_LOGV(TAG, "UART connectivity test: received %d bytes", echo_length);
-    if (echo_length > 0) {
-        ESP_LOGV(TAG, "UART appears to be working - received response!");
-        for (int i = 0; i < echo_length; i++) {
-            ESP_LOGV(TAG, "Response byte[%d]: 0x%02X", i, echo_buffer[i]);
+
+    // Min/max/divergence need every cell, individual cell sensors only their own
+    bool cell_stats = this->min_cell_voltage_sensor_ != nullptr || this->max_cell_voltage_sensor_ != nullptr ||
+                      this->cell_divergence_sensor_ != nullptr;
+    for (uint8_t i = 0; i < 10; i++) {
+        if (cell_stats || this->cell_voltage_sensors_[i] != nullptr) {
+            cells |= 1 << i;
         }
-    } else {
-        ESP_LOGV(TAG, "No echo received - this is normal for XGT battery (doesn't echo test bytes)");
     }
-    ESP_LOGV(TAG, "=== END UART TEST ===");
+#ifdef USE_XGT_BATTERY_HISTORY
+    // The history records every cell, pack voltage and temperature, with or without sensors
+    if (this->history_enabled_()) {
+        cells = (1 << HISTORY_CELLS) - 1;
+        registers |= (1 << REG_PACK_VOLTAGE) | (1 << REG_TEMPERATURE);
+    }
+#endif
+    if (cells != 0) {
+        registers |= 1 << REG_CELL_VOLTAGES;
+    }
+    this->poller_.set_needed(registers, cells);
+    // pack_connected needs an answer on every cycle, also those where only slow registers would be due
+    this->poller_.set_presence_probe(this->pack_connected_binary_sensor_ != nullptr);
 }
 
 void XGTBattery::loop() {
-    uint32_t now = millis();
-    
-    // Check if it's time to start a new data collection cycle
-    if (current_state_ == STATE_IDLE && now - this->last_update_ > this->update_interval_) {
-        current_state_ = STATE_WAKE;
-        state_start_time_ = now;
-        current_cell_ = 0;
+    this->deliver_captures_();
+    this->deliver_reads_();
+#ifdef USE_XGT_BATTERY_TASK
+    if (this->use_task_) {
+        // The task does all bus I/O; here only a finished cycle is published
+        if (this->handoff_.read(&this->published_, &this->handoff_seq_)) {
+            this->publish_snapshot_(this->published_);
+        }
+        return;
+    }
+#endif
+    this->acquire_(millis());
+}
+
+void XGTBattery::acquire_(uint32_t now) {
+    // Check if it's time to start a new data collection cycle. On a shared bus it waits for this pack's turn.
+    if (current_state_ == STATE_IDLE && this->capture_pending_.load(std::memory_order_acquire)) {
+        this->apply_capture_request_(now);
+    }
+    if (current_state_ == STATE_IDLE && this->scan_pending_.load(std::memory_order_acquire)) {
+        this->apply_scan_request_();
+    }
+    bool due = this->start_now_ || this->read_pending_.load(std::memory_order_acquire) ||
+               now - this->last_update_ > this->cycle_interval_();
+    if (current_state_ == STATE_IDLE && due && this->acquire_bus_(now)) {
+        this->start_cycle_(now);
     }
     
-    // Process current state
-    if (current_state_ != STATE_IDLE) {
+    // Advance the in-flight transaction, or the state machine once the bus is free
+    if (this->tx_phase_ != TX_IDLE) {
+        this->run_transaction();
+    } else if (current_state_ != STATE_IDLE) {
         process_current_state();
     }
 }
 
+#ifdef USE_XGT_BATTERY_TASK
+void XGTBattery::polling_task_(void *param) {
+    XGTBattery *battery = static_cast<XGTBattery *>(param);
+    while (true) {
+        uint8_t trace_request = battery->trace_request_.exchange(0);
+        if (trace_request != 0) {
+            battery->write_trace_(trace_request == 2);
+        }
+        battery->acquire_(millis());
+        uint32_t sleep_ms = battery->next_step_ms_(millis());
+        vTaskDelay(sleep_ms > 0 && pdMS_TO_TICKS(sleep_ms) == 0 ? 1 : pdMS_TO_TICKS(sleep_ms));
+    }
+}
+
+uint32_t XGTBattery::next_step_ms_(uint32_t now) const {
+    // Sleep until the running phase, command gap or next cycle is due instead of stepping every tick
+    uint32_t start;
+    uint32_t duration;
+    if (this->tx_phase_ == TX_RECEIVE) {
+#ifdef XGT_BATTERY_RX_WAIT
+        return 0;  // wait_rx_() already slept in the UART driver
+#else
+        return 1;
+#endif
+    } else if (this->tx_phase_ != TX_IDLE) {
+        start = this->tx_phase_start_;
+        duration = this->tx_phase_duration_;
+    } else if (current_state_ == STATE_IDLE) {
+        if (this->bus_waiting_) {
+            return 10;
+        }
+        if (this->start_now_ || this->read_pending_.load(std::memory_order_acquire)) {
+            return 0;
+        }
+        start = this->last_update_;
+        duration = this->cycle_interval_() + 1;
+    } else if (current_state_ == STATE_WAKE) {
+        start = state_start_time_;
+        duration = 10;
+    } else if (current_state_ == STATE_REGISTERS && this->poller_.pending() != nullptr) {
+        start = state_start_time_;
+        duration = this->command_gap_(this->poller_.pending()->gap_ms);
+    } else if (current_state_ == STATE_READS) {
+        start = state_start_time_;
+        duration = READ_GAP_MS;
+    } else {
+        return 1;
+    }
+    uint32_t elapsed = now - start;
+    if (elapsed >= duration) {
+        return 0;
+    }
+    // Capped so dump_trace requests are still served promptly
+    return duration - elapsed < 100 ? duration - elapsed : 100;
+}
+#endif
+
+#ifdef XGT_BATTERY_RX_WAIT
+void XGTBattery::wait_rx_() {
+    // Block in the driver until the bytes the frame still needs have arrived or the phase times out: one
+    // wake for the first byte (onset timing), one for the rest of the frame, one for a long frame's idle gap
+    uint32_t elapsed = millis() - this->tx_phase_start_;
+    if (elapsed >= this->tx_phase_duration_ || this->rx_length_ >= sizeof(this->command_buffer_)) {
+        return;
+    }
+    FrameState state = frame_state(this->command_buffer_, this->rx_length_);
+    if (state == FRAME_COMPLETE) {
+        return;
+    }
+    uint32_t wait_ms = this->tx_phase_duration_ - elapsed;
+    if (state == FRAME_NEEDS_IDLE && wait_ms > this->tx_time_ms_(3)) {
+        wait_ms = this->tx_time_ms_(3);
+    }
+    uint8_t want = frame_bytes_missing(this->command_buffer_, this->rx_length_);
+    if (want > sizeof(this->command_buffer_) - this->rx_length_) {
+        want = sizeof(this->command_buffer_) - this->rx_length_;
+    }
+
+    uint8_t bytes[sizeof(this->command_buffer_)];
+    int received = uart_read_bytes(this->uart_num_, bytes, want, pdMS_TO_TICKS(wait_ms) > 0 ? pdMS_TO_TICKS(wait_ms) : 1);
+    uint32_t now = millis();
+    for (int i = 0; i < received; i++) {
+        this->receive_byte_(bytes[i], now);
+    }
+}
+#endif
+
 void XGTBattery::dump_config() {
     ESP_LOGCONFIG(TAG, "XGT Battery:");
     ESP_LOGCONFIG(TAG, "  Update Interval: %u ms", this->update_interval_);
+    if (this->absent_backoff_ > 0) {
+        ESP_LOGCONFIG(TAG, "  Absent Backoff: up to %u ms", this->absent_backoff_);
+    }
+    LOG_BINARY_SENSOR("  ", "Pack Connected", this->pack_connected_binary_sensor_);
+    ESP_LOGCONFIG(TAG, "  Light Sleep: %s", YESNO(this->light_sleep_));
+    LOG_SENSOR("  ", "Duty Cycle", this->duty_cycle_sensor_);
+    LOG_SENSOR("  ", "Average Current", this->average_current_sensor_);
+    ESP_LOGCONFIG(TAG, "  Slow Interval: %u ms", this->poller_.class_interval(POLL_SLOW));
+    ESP_LOGCONFIG(TAG, "  Static Interval: %u ms", this->poller_.class_interval(POLL_STATIC));
+    ESP_LOGCONFIG(TAG, "  Adaptive Timing: %s (margin %u ms)", YESNO(this->adaptive_timing_), this->timing_margin_);
+    LOG_SENSOR("  ", "Response Time", this->response_time_sensor_);
+    LOG_SENSOR("  ", "Response Timeout", this->response_timeout_sensor_);
+    LOG_SENSOR("  ", "Command Gap", this->command_gap_sensor_);
+    LOG_SENSOR("  ", "Cycle Time", this->cycle_time_sensor_);
+#ifdef USE_XGT_BATTERY_TASK
+    if (this->use_task_) {
+        ESP_LOGCONFIG(TAG, "  Polling Task: core %u, priority %u", this->task_core_, this->task_priority_);
+#ifdef XGT_BATTERY_RX_WAIT
+        ESP_LOGCONFIG(TAG, "  Receive: waits in the UART driver");
+#endif
+    }
+#endif
+    if (this->bus_ != nullptr && this->bus_->members() > 1) {
+        ESP_LOGCONFIG(TAG, "  Shared Bus: %u packs", this->bus_->members());
+        LOG_PIN("  Select Pin: ", this->select_pin_);
+        LOG_SENSOR("  ", "Bus Wait", this->bus_wait_sensor_);
+    }
+#if defined(XGT_BATTERY_TRACE_RING)
+    ESP_LOGCONFIG(TAG, "  Trace: ring (%u frames)", this->trace_size_);
+#elif defined(XGT_BATTERY_TRACE_LOG)
+    ESP_LOGCONFIG(TAG, "  Trace: log");
+#else
+    ESP_LOGCONFIG(TAG, "  Trace: none");
+#endif
+#ifdef USE_XGT_BATTERY_HISTORY
+    if (this->history_enabled_()) {
+        ESP_LOGCONFIG(TAG, "  History: %u + %u + %u samples, %u bytes", this->history_samples_[0],
+                      this->history_samples_[1], this->history_samples_[2],
+                      static_cast<unsigned>(this->history_.memory_size()));
+        ESP_LOGCONFIG(TAG, "    Polls every cell, pack voltage and temperature, with or without sensors");
+    }
+#endif
+    ESP_LOGCONFIG(TAG, "  Batched Reads: %s", YESNO(this->poller_.batch_reads()));
+    ESP_LOGCONFIG(TAG, "  Strict CRC: %s (retry budget %u)", YESNO(this->poller_.strict_crc()),
+                  this->poller_.retry_budget());
+    if (this->max_value_age_ > 0) {
+        ESP_LOGCONFIG(TAG, "  Max Value Age: %u ms", this->max_value_age_);
+    }
+    static const char *const CLASS_NAMES[POLL_CLASS_COUNT] = {"static", "slow", "fast"};
+    for (uint8_t i = 0; i < REG_COUNT; i++) {
+        ESP_LOGCONFIG(TAG, "    %s: %s%s", REGISTERS[i].name, CLASS_NAMES[this->poller_.poll_class(i)],
+                      (this->poller_.needed_registers() & (1 << i)) ? "" : " (not polled, no sensor configured)");
+    }
+    ESP_LOGCONFIG(TAG, "  Polled Cells: 0x%03X", this->poller_.needed_cells());
     
     // Validate UART settings for XGT battery requirements
     ESP_LOGCONFIG(TAG, "  UART Configuration:");
@@ -141,181 +365,921 @@ float XGTBattery::get_setup_priority() const {
     return setup_priority::DATA;
 }
 
-bool XGTBattery::check_crc(uint8_t *rx_buf, uint8_t length) {
-    uint16_t crc = 0;
-    
-    // Check message format validity - match working implementation exactly
-    if (rx_buf[0] == 0xA5 && rx_buf[1] == 0xA5 || rx_buf[0] == 0xCC && rx_buf[7] == 0x33) {
-        if (rx_buf[0] == 0xCC) {
-            // Short message type
-            crc += rx_buf[0];                        // add first byte (0xCC)
-            for (uint8_t i = 2; i < length; i++) {  // loop starting at position 2 to exclude CRC
-                crc += rx_buf[i];                    // sum bytes in packet
+void XGTBattery::start_transaction(const uint8_t *command, uint8_t cmd_length, bool expect_response, uint8_t reg,
+                                   TransactionCallback &&callback) {
+    if (cmd_length > sizeof(this->tx_command_)) {
+        cmd_length = sizeof(this->tx_command_);
+    }
+    memcpy(this->tx_command_, command, cmd_length);
+    this->tx_cmd_length_ = cmd_length;
+    this->tx_expect_response_ = expect_response;
+    this->tx_register_ = reg;
+    this->tx_callback_ = std::move(callback);
+    this->tx_attempts_ = 0;
+    this->rx_length_ = 0;
+    this->tx_start_time_ = millis();
+    this->send_command_();
+}
+
+void XGTBattery::send_command_() {
+    this->tx_attempts_++;
+
+#ifdef XGT_BATTERY_TRACE_LOG
+    // Debug: Print command being sent - show ALL bytes for model command
+    ESP_LOGV(TAG, "Sending command (%d bytes), attempt %d:", this->tx_cmd_length_, this->tx_attempts_);
+    for (uint8_t i = 0; i < this->tx_cmd_length_; i++) {
+        ESP_LOGV(TAG, "  CMD[%d] = 0x%02X", i, this->tx_command_[i]);
+    }
+#endif
+
+    // Discard anything left over from a previous command before we start talking
+    this->drain_rx_();
+
+    // No flush() here: it would block until the UART has shifted out every byte. The command
+    // fits in the hardware FIFO, so we just wait for the computed wire time instead.
+    this->write_array(this->tx_command_, this->tx_cmd_length_);
+    this->set_phase_(TX_SENDING, millis(), this->tx_time_ms_(this->tx_cmd_length_));
+}
+
+void XGTBattery::drain_rx_() {
+    // CRITICAL: Clear input buffer like INO file does with uart_flush()
+    // This prevents reading stale data from previous commands
+    uint8_t byte;
+#ifdef XGT_BATTERY_TRACE_LOG
+    uint8_t cleared = 0;
+    while (this->available() && this->read_byte(&byte)) {
+        cleared++;
+    }
+    if (cleared > 0) {
+        ESP_LOGV(TAG, "Cleared %d stale bytes from input buffer", cleared);
+    }
+#else
+    while (this->available() && this->read_byte(&byte)) {
+    }
+#endif
+}
+
+uint32_t XGTBattery::first_byte_timeout_(bool is_long_command) const {
+    uint32_t default_ms = is_long_command ? LONG_SETTLE_MS + LONG_RX_TIMEOUT_MS : SHORT_SETTLE_MS + SHORT_RX_TIMEOUT_MS;
+    if (!this->adaptive_timing_) {
+        return default_ms;
+    }
+    return this->timing_.first_byte_timeout_ms(this->tx_register_, default_ms);
+}
+
+uint32_t XGTBattery::command_gap_(uint32_t configured_ms) const {
+    return this->adaptive_timing_ ? this->timing_.gap_ms(configured_ms) : configured_ms;
+}
+
+uint32_t XGTBattery::tx_time_ms_(uint8_t length) const {
+    return wire_time_ms(length, this->parent_->get_baud_rate());
+}
+
+void XGTBattery::set_phase_(TransactionPhase phase, uint32_t now, uint32_t duration) {
+    this->tx_phase_ = phase;
+    this->tx_phase_start_ = now;
+    this->tx_phase_duration_ = duration;
+}
+
+void XGTBattery::run_transaction() {
+    uint32_t now = millis();
+    bool is_long_command = (this->tx_command_[0] == 0xA5 && this->tx_command_[1] == 0xA5);
+
+    switch (this->tx_phase_) {
+        case TX_SENDING:
+            if (now - this->tx_phase_start_ < this->tx_phase_duration_) {
+                return;
             }
-            crc = crc % 256;  // take modulo 256
-            if (crc != rx_buf[1]) {
-                return false;  // if calculated CRC does not match byte 1 (crc) return false
+            // Command is on the wire; drop the echo/stale bytes like the blocking version did after flush()
+            this->drain_rx_();
+            if (!this->tx_expect_response_) {
+                // Wake byte: the battery needs 70ms before it accepts commands
+                this->set_phase_(TX_SETTLE, now, WAKE_SETTLE_MS);
+                return;
             }
-        } else {
-            // Long message type
-            length -= (rx_buf[3] & 0xF);                 // size of data - number of padding bytes
-            for (uint8_t i = 2; i < length - 2; i++) {  // exclude A5A5 header and final word (CRC)
-                crc += rx_buf[i];
+            // Listen straight away so the response onset can be measured. The first byte may take the
+            // settle time plus the RX timeout of the working implementation, or the learned timeout.
+            this->rx_length_ = 0;
+            this->tx_end_time_ = now;
+            this->set_phase_(TX_RECEIVE, now, this->first_byte_timeout_(is_long_command));
+            return;
+
+        case TX_SETTLE:
+            if (now - this->tx_phase_start_ >= this->tx_phase_duration_) {
+                this->finish_transaction_();
+            }
+            return;
+
+        case TX_RECEIVE: {
+#ifdef XGT_BATTERY_RX_WAIT
+            if (this->use_task_) {
+                this->wait_rx_();
+                now = millis();
             }
-            if ((rx_buf[length - 2] << 8 | rx_buf[length - 1]) != crc) {
-                return false;
+#endif
+            int available = this->available();
+            while (available-- > 0 && this->rx_length_ < sizeof(this->command_buffer_)) {
+                uint8_t byte;
+                if (!this->read_byte(&byte)) {
+                    break;
+                }
+                this->receive_byte_(byte, now);
+            }
+
+            bool complete = this->rx_length_ >= sizeof(this->command_buffer_) || this->frame_complete_(now);
+            if (!complete && now - this->tx_phase_start_ < this->tx_phase_duration_) {
+                return;
             }
+
+            XGT_TRACE_LOGV("ESPHome UART: sent %d bytes, received %d bytes (%s)", this->tx_cmd_length_, this->rx_length_,
+                           complete ? "frame complete" : "timeout");
+            if (this->rx_length_ == 0 && this->tx_attempts_ < MAX_ATTEMPTS) {
+                this->count_health_(HEALTH_RETRIES);
+                this->set_phase_(TX_RETRY_WAIT, now, RETRY_DELAY_MS);  // Match working implementation retry delay
+                return;
+            }
+            this->finish_transaction_();
+            return;
         }
-    } else {
-        return false;  // Invalid message format
+
+        case TX_RETRY_WAIT:
+            if (now - this->tx_phase_start_ >= this->tx_phase_duration_) {
+                this->send_command_();
+            }
+            return;
+
+        case TX_IDLE:
+        default:
+            return;
     }
-    return true;  // return true, good CRC
 }
 
-int8_t XGTBattery::send_battery(uint8_t *buf, const uint8_t *command, uint8_t cmd_length, uint8_t *rx_length) {
-    *rx_length = 0;
-    uint8_t attempts = 0;
-    
-    // Detect command type based on first bytes
-    bool is_long_command = (command[0] == 0xA5 && command[1] == 0xA5);
-    
-    ESP_LOGV(TAG, "Command type: %s (%d bytes)", is_long_command ? "LONG" : "SHORT", cmd_length);
-    
-    while (*rx_length == 0 && attempts <= 1) {
-        if (attempts > 0) {
-            delay(50);  // Match working implementation retry delay
+void XGTBattery::receive_byte_(uint8_t byte, uint32_t now) {
+    XGT_TRACE_LOGV("  RAW[%d] = 0x%02X", this->rx_length_, byte);
+    // Half duplex: no echo removal needed, all received bytes are response data for both
+    // short and long commands. Convert bit order from MSB first to LSB first as they arrive.
+    this->command_buffer_[this->rx_length_++] = reverse_bits(byte);
+    this->rx_last_byte_time_ = now;
+    // If we got some data, give a little more time for remaining bytes
+    if (this->rx_length_ == 1) {
+        if (this->adaptive_timing_) {
+            this->timing_.record_onset(this->tx_register_, now - this->tx_end_time_);
         }
-        attempts++;
-        
-        // Debug: Print command being sent - show ALL bytes for model command
-        ESP_LOGV(TAG, "Sending command (%d bytes):", cmd_length);
-        for (uint8_t i = 0; i < cmd_length; i++) {  // Show ALL bytes, not just first 16
-            ESP_LOGV(TAG, "  CMD[%d] = 0x%02X", i, command[i]);
+        bool is_long_command = (this->tx_command_[0] == 0xA5 && this->tx_command_[1] == 0xA5);
+        this->set_phase_(TX_RECEIVE, now, is_long_command ? LONG_RX_TIMEOUT_MS : SHORT_RX_TIMEOUT_MS);
+    }
+}
+
+bool XGTBattery::frame_complete_(uint32_t now) const {
+    switch (frame_state(this->command_buffer_, this->rx_length_)) {
+        case FRAME_COMPLETE:
+            return true;
+        case FRAME_NEEDS_IDLE:
+            // Long frame: done once the line has been idle for a few character times
+            return now - this->rx_last_byte_time_ >= this->tx_time_ms_(3);
+        case FRAME_INCOMPLETE:
+        default:
+            // Includes unknown start bytes: keep collecting until the timeout, like the original implementation
+            return false;
+    }
+}
+
+void XGTBattery::finish_transaction_() {
+    int8_t result = 0;
+    uint8_t *buf = this->command_buffer_;
+
+    if (!this->tx_expect_response_) {
+        result = 0;
+    } else if (this->rx_length_ < 8) {
+        result = 1;  // Need at least 8 bytes minimum
+    } else {
+#ifdef XGT_BATTERY_TRACE_LOG
+        // Debug: Print response data AFTER bit reversal
+        ESP_LOGV(TAG, "After bit reversal, response %d bytes:", this->rx_length_);
+        for (uint8_t i = 0; i < this->rx_length_ && i < 16; i++) {
+            ESP_LOGV(TAG, "  [%d] = 0x%02X", i, buf[i]);
         }
-        
-        // Use ESPHome native UART methods to avoid driver conflicts
-        this->write_array(command, cmd_length);  // Send command
-        this->flush();                           // Wait for TX completion and flush buffers
-        
-        // CRITICAL: Clear input buffer like INO file does with uart_flush()
-        // This prevents reading stale data from previous commands
-        ESP_LOGV(TAG, "Clearing input buffer...");
-        uint8_t cleared = 0;
-        while (this->available()) {
-            this->read();
-            cleared++;
+#endif
+
+        if (!check_crc(buf, this->rx_length_)) {
+            ESP_LOGW(TAG, "CRC check failed for %d byte message", this->rx_length_);
+            result = -1;  // CRC error
         }
-        ESP_LOGV(TAG, "Cleared %d stale bytes from input buffer", cleared);
-        
-        // Give battery more time for long commands (model command needs longer)
-        if (is_long_command) {
-            delay(50);  // Model command needs more time
+    }
+
+    if (this->tx_expect_response_) {
+        if (result == 0) {
+            this->count_health_(HEALTH_SUCCESS);
+            this->record_latency_(millis() - this->tx_start_time_);
+        } else if (result == -1) {
+            this->count_health_(HEALTH_CRC_ERRORS);
         } else {
-            delay(15);  // Normal commands
+            this->count_health_(this->rx_length_ == 0 ? HEALTH_TIMEOUTS : HEALTH_SHORT_FRAMES);
         }
-        
-        // Read response using ESPHome method with longer timeout for model command
-        uint32_t timeout_ms = is_long_command ? 100 : 25;  // Longer timeout for model command
-        uint32_t start_time = millis();
-        *rx_length = 0;
-        while (*rx_length < 32 && (millis() - start_time) < timeout_ms) {
-            if (this->available()) {
-                buf[*rx_length] = this->read();
-                (*rx_length)++;
-                // If we got some data, give a little more time for remaining bytes
-                if (*rx_length == 1) {
-                    start_time = millis();  // Reset timer on first byte
-                }
-            } else {
-                delay(1);  // Small delay to prevent tight polling
+    }
+    if (this->tx_expect_response_ && result != 0) {
+        this->record_failure_();
+    }
+
+#ifdef XGT_BATTERY_TRACE_RING
+    // Keep the response as it was on the wire, like the command
+    uint8_t raw[MAX_FRAME_LENGTH];
+    uint8_t raw_length = this->tx_expect_response_ ? this->rx_length_ : 0;
+    for (uint8_t i = 0; i < raw_length; i++) {
+        raw[i] = reverse_bits(buf[i]);
+    }
+    this->trace_.record(millis(), this->tx_register_, result, this->tx_attempts_, this->tx_command_,
+                        this->tx_cmd_length_, raw, raw_length);
+#endif
+
+    this->tx_phase_ = TX_IDLE;
+    // Move the callback out first: it usually starts the next transaction
+    TransactionCallback callback = std::move(this->tx_callback_);
+    this->tx_callback_ = nullptr;
+    if (callback) {
+        callback(result, buf, this->rx_length_);
+    }
+}
+
+void XGTBattery::dump_trace(bool binary) {
+#ifdef USE_XGT_BATTERY_TASK
+    if (this->use_task_) {
+        // The ring belongs to the polling task, which logs it before its next step
+        this->trace_request_.store(binary ? 2 : 1);
+        return;
+    }
+#endif
+    this->write_trace_(binary);
+}
+
+void XGTBattery::write_trace_(bool binary) {
+#ifdef XGT_BATTERY_TRACE_RING
+    if (binary) {
+        // Numbered chunks with a marker, so the replay tool can pick them out of a captured log
+        std::vector<uint8_t> blob(this->trace_.blob_size());
+        this->trace_.write_blob(blob.data());
+        ESP_LOGI(TAG, "Frame trace blob, %u frames, %u bytes:", this->trace_.size(),
+                 static_cast<unsigned>(blob.size()));
+        for (size_t offset = 0; offset < blob.size(); offset += 32) {
+            size_t length = blob.size() - offset < 32 ? blob.size() - offset : 32;
+            ESP_LOGI(TAG, "XGTTRACE %03u %s", static_cast<unsigned>(offset / 32),
+                     format_hex(blob.data() + offset, length).c_str());
+        }
+        return;
+    }
+    ESP_LOGI(TAG, "Frame trace, %u of %u frames (wire order):", this->trace_.size(), this->trace_.capacity());
+    for (uint8_t i = 0; i < this->trace_.size(); i++) {
+        const TraceFrame &frame = this->trace_.at(i);
+        ESP_LOGI(TAG, "  %10u %-19s result=%2d attempts=%u TX %s RX %s", frame.time_ms,
+                 frame.reg < REG_COUNT    ? REGISTERS[frame.reg].name
+                 : frame.reg == REG_READ  ? "read"
+                 : frame.tx_length > 1    ? "batch"
+                                          : "wake",
+                 frame.result, frame.attempts,
+                 format_hex(frame.tx, frame.tx_length).c_str(), format_hex(frame.rx, frame.rx_length).c_str());
+    }
+#else
+    ESP_LOGW(TAG, "Frame trace not compiled in, set trace: ring");
+#endif
+}
+
+uint32_t XGTBattery::cycle_interval_() const {
+    if (this->poller_.capture_active()) {
+        return 0;  // Rows back to back
+    }
+    uint8_t absent_cycles = this->poller_.absent_cycles();
+    if (this->absent_backoff_ == 0 || absent_cycles < 2) {
+        return this->update_interval_;
+    }
+    // Exponential backoff while no pack answers: 2x, 4x, ... update_interval, up to absent_backoff
+    uint32_t interval = this->update_interval_;
+    for (uint8_t i = 1; i < absent_cycles && interval < this->absent_backoff_; i++) {
+        interval *= 2;
+    }
+    return interval < this->absent_backoff_ ? interval : this->absent_backoff_;
+}
+
+bool XGTBattery::acquire_bus_(uint32_t now) {
+    if (this->bus_ == nullptr) {
+        return true;
+    }
+    if (!this->bus_->acquire(this)) {
+        if (!this->bus_waiting_) {
+            this->bus_waiting_ = true;
+            this->bus_wait_start_ = now;
+        }
+        return false;
+    }
+
+    this->bus_wait_ms_ = this->bus_waiting_ ? now - this->bus_wait_start_ : 0;
+    this->bus_waiting_ = false;
+    if (this->select_pin_ != nullptr) {
+        this->select_pin_->digital_write(true);
+    }
+    return true;
+}
+
+void XGTBattery::release_bus_() {
+    if (this->bus_ == nullptr) {
+        return;
+    }
+    if (this->select_pin_ != nullptr) {
+        this->select_pin_->digital_write(false);
+    }
+    this->bus_->release(this);
+}
+
+void XGTBattery::start_cycle_(uint32_t now) {
+    // cycle_responses() still counts the previous cycle here
+    bool woke = !this->poller_.capture_active() || this->poller_.cycle_responses() == 0 ||
+                now - this->last_update_ >= CAPTURE_AWAKE_MS;
+    this->log_poll_events_(this->poller_.begin_cycle(now, woke));
+    if (this->read_pending_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> guard(this->read_lock_);
+        this->cycle_reads_.swap(this->read_queue_);  // cycle_reads_ is empty here, see finish_cycle_()
+        this->read_pending_.store(false, std::memory_order_relaxed);
+    }
+    this->scan_cycle_reads_ = 0;
+    this->cycle_start_time_ = now;
+    this->start_now_ = false;
+
+#ifdef USE_XGT_BATTERY_LIGHT_SLEEP
+    if (this->pm_apb_lock_ != nullptr) {
+        esp_pm_lock_acquire(this->pm_apb_lock_);
+        esp_pm_lock_acquire(this->pm_sleep_lock_);
+    }
+#endif
+
+    current_state_ = woke ? STATE_WAKE : STATE_REGISTERS;
+    state_start_time_ = now;
+    // Keep loop() spinning fast while a cycle runs so phase deadlines are met within ~1ms.
+    // The polling task paces itself.
+    if (!this->use_task_) {
+        this->high_freq_.start();
+    }
+}
+
+void XGTBattery::finish_cycle_(uint32_t now) {
+    this->log_poll_events_(this->poller_.end_cycle(now));
+
+    // Reads left over when the cycle ended early: nothing answered the table's first command
+    for (RegisterRead &pending : this->cycle_reads_) {
+        pending.result = 1;
+        this->finish_read_(std::move(pending));
+    }
+    this->cycle_reads_.clear();
+
+    if (this->adaptive_timing_) {
+        this->timing_.cycle_complete();
+    }
+    if (this->poller_.capture_active()) {
+        // Sensors keep their last values until the capture ends and a normal cycle runs
+        this->record_capture_(now);
+    } else {
+        this->take_snapshot_(now);
+#ifdef USE_XGT_BATTERY_TASK
+        if (this->use_task_) {
+            this->handoff_.write(this->snapshot_);
+        } else {
+            this->publish_snapshot_(this->snapshot_);
+        }
+#else
+        this->publish_snapshot_(this->snapshot_);
+#endif
+    }
+
+    current_state_ = STATE_IDLE;
+    this->last_update_ = now;
+    this->release_bus_();
+#ifdef USE_XGT_BATTERY_LIGHT_SLEEP
+    if (this->pm_apb_lock_ != nullptr) {
+        esp_pm_lock_release(this->pm_sleep_lock_);
+        esp_pm_lock_release(this->pm_apb_lock_);
+    }
+#endif
+    if (!this->poller_.capture_active()) {
+        this->high_freq_.stop();
+    }
+}
+
+void XGTBattery::start_capture(uint16_t registers, uint8_t cell, uint32_t duration_ms, uint8_t batch_size) {
+    std::lock_guard<std::mutex> guard(this->capture_lock_);
+    this->capture_request_ = {registers, cell, duration_ms, batch_size > 0 ? batch_size : static_cast<uint8_t>(1)};
+    this->capture_pending_.store(true, std::memory_order_release);
+}
+
+void XGTBattery::apply_capture_request_(uint32_t now) {
+    CaptureRequest request;
+    {
+        std::lock_guard<std::mutex> guard(this->capture_lock_);
+        request = this->capture_request_;
+        this->capture_pending_.store(false, std::memory_order_relaxed);
+    }
+    if (request.duration_ms == 0) {
+        if (this->poller_.capture_active()) {
+            this->flush_capture_();
+            this->end_capture_();
+        }
+        return;
+    }
+    // A new request replaces a running capture, whose rows so far are delivered first
+    this->flush_capture_();
+    this->poller_.start_capture(request.registers, request.cell);
+    this->capture_start_ = now;
+    this->capture_duration_ = request.duration_ms;
+    this->capture_batch_size_ = request.batch_size;
+    this->capture_batch_.reserve(request.batch_size);
+    ESP_LOGI(TAG, "Live capture for %u ms", request.duration_ms);
+}
+
+void XGTBattery::record_capture_(uint32_t now) {
+    const PackPoller &poller = this->poller_;
+    if (poller.cycle_responses() > 0) {
+        // A value belongs to this row if its last good read happened since the row started
+        uint32_t row_age = now - this->cycle_start_time_;
+        CaptureSample sample{this->cycle_start_time_, {0}, 0, poller.capture_cell()};
+        for (uint8_t reg = 0; reg < REG_CELL_VOLTAGES; reg++) {
+            if ((poller.capture_registers() & (1 << reg)) && (poller.good_registers() & (1 << reg)) &&
+                now - poller.last_good(reg) <= row_age) {
+                sample.raw[reg] = poller.raw_values()[reg];
+                sample.valid |= 1 << reg;
             }
         }
-        
-        ESP_LOGV(TAG, "ESPHome UART: sent %d bytes, received %d bytes", cmd_length, *rx_length);
+        uint8_t cell = poller.capture_cell();
+        if (cell > 0 && cell <= poller.last_cell() && (poller.good_cells() & (1 << (cell - 1))) &&
+            now - poller.cell_last_good(cell) <= row_age) {
+            sample.raw[REG_CELL_VOLTAGES] = poller.cell_values()[cell - 1];
+            sample.valid |= 1 << REG_CELL_VOLTAGES;
+        }
+        this->capture_batch_.push_back(sample);
     }
-    
-    if (*rx_length < 8) {
-        return 1;  // Need at least 8 bytes minimum
+
+    bool done = now - this->capture_start_ >= this->capture_duration_ || (!poller.pack_present() && poller.cycle_woke());
+    if (this->capture_batch_.size() >= this->capture_batch_size_ || done) {
+        this->flush_capture_();
     }
-    
-    // Debug: Print RAW received data BEFORE processing
-    ESP_LOGV(TAG, "Raw received %d bytes:", *rx_length);
-    for (uint8_t i = 0; i < *rx_length && i < 32; i++) {
-        ESP_LOGV(TAG, "  RAW[%d] = 0x%02X", i, buf[i]);
+    if (done) {
+        this->end_capture_();
     }
-    
-    if (is_long_command) {
-        // Long command (model): Process like INO file - NO echo removal, process response directly
-        ESP_LOGV(TAG, "Processing as LONG command (model) - processing %d-byte response directly", *rx_length);
-        
-        // Convert bit order from MSB first to LSB first for the response (like INO file)
-        for (uint8_t i = 0; i < *rx_length; ++i) {
-            buf[i] = (lookup_[buf[i] & 0b1111] << 4) | lookup_[buf[i] >> 4];
+}
+
+void XGTBattery::flush_capture_() {
+    if (this->capture_batch_.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(this->capture_lock_);
+    this->capture_ready_.push_back(std::move(this->capture_batch_));
+    this->capture_batch_ = std::vector<CaptureSample>();
+    this->capture_batch_.reserve(this->capture_batch_size_);
+}
+
+void XGTBattery::end_capture_() {
+    ESP_LOGI(TAG, "Live capture finished, resuming normal polling");
+    this->poller_.end_capture();
+    this->start_now_ = true;
+}
+
+void XGTBattery::deliver_captures_() {
+    std::vector<std::vector<CaptureSample>> ready;
+    {
+        std::lock_guard<std::mutex> guard(this->capture_lock_);
+        if (this->capture_ready_.empty()) {
+            return;
         }
-        
+        ready.swap(this->capture_ready_);
+    }
+    for (auto &batch : ready) {
+        this->capture_callback_.call(std::move(batch));
+    }
+}
+
+float XGTBattery::capture_value(const CaptureSample &sample, Register reg) {
+    if (reg >= REG_COUNT || !(sample.valid & (1 << reg))) {
+        return NAN;
+    }
+    if (reg == REG_CELL_VOLTAGES) {
+        return cell_voltage_(sample.raw[reg]);
+    }
+    return register_value(reg, sample.raw);
+}
+
+bool XGTBattery::read_register(const std::string &request, bool long_frame, uint8_t type) {
+    RegisterRead pending{};
+    if (!parse_hex_bytes(request, &pending.request) ||
+        (long_frame ? pending.request.size() > MAX_FRAME_LENGTH - LONG_FRAME_OVERHEAD
+                    : pending.request.size() != ADDRESS_LENGTH)) {
+        ESP_LOGW(TAG, "Cannot read '%s': expected %s", request.c_str(),
+                 long_frame ? "a payload of up to 26 hex bytes" : "a register address of 4 hex bytes");
+        return false;
+    }
+    pending.long_frame = long_frame;
+    pending.type = type;
+    std::lock_guard<std::mutex> guard(this->read_lock_);
+    if (this->read_queue_.size() >= READ_QUEUE_MAX) {
+        ESP_LOGW(TAG, "Register read queue full, dropping '%s'", request.c_str());
+        return false;
+    }
+    this->read_queue_.push_back(std::move(pending));
+    this->read_pending_.store(true, std::memory_order_release);
+    return true;
+}
+
+void XGTBattery::scan_registers(const std::string &address, uint8_t index, uint8_t first, uint8_t last, uint8_t step,
+                                uint32_t interval_ms) {
+    ScanRequest request{};
+    if (interval_ms > 0) {
+        std::vector<uint8_t> bytes;
+        if (!parse_hex_bytes(address, &bytes) || bytes.size() != ADDRESS_LENGTH || index >= ADDRESS_LENGTH ||
+            first > last || step == 0) {
+            ESP_LOGW(TAG, "Invalid register scan of '%s', byte %u from %u to %u", address.c_str(), index, first, last);
+            return;
+        }
+        memcpy(request.address, bytes.data(), ADDRESS_LENGTH);
+        request.index = index;
+        request.first = first;
+        request.last = last;
+        request.step = step;
+        request.interval_ms = interval_ms;
+    }
+    std::lock_guard<std::mutex> guard(this->read_lock_);
+    this->scan_request_ = request;
+    this->scan_pending_.store(true, std::memory_order_release);
+}
+
+void XGTBattery::apply_scan_request_() {
+    ScanRequest request;
+    {
+        std::lock_guard<std::mutex> guard(this->read_lock_);
+        request = this->scan_request_;
+        this->scan_pending_.store(false, std::memory_order_relaxed);
+    }
+    if (this->scan_.interval_ms > 0 && this->scan_next_ <= this->scan_.last) {
+        ESP_LOGI(TAG, "Register scan stopped after %u reads, %u addresses answered", this->scan_sent_,
+                 this->scan_answered_);
+    }
+    this->scan_ = request;
+    this->scan_next_ = request.first;
+    this->scan_sent_ = 0;
+    this->scan_answered_ = 0;
+    if (request.interval_ms > 0) {
+        char pattern[ADDRESS_LENGTH * 3 + 1];  // "C0 03 xx 00"
+        for (uint8_t i = 0; i < ADDRESS_LENGTH; i++) {
+            snprintf(pattern + i * 3, 4, i == request.index ? "xx " : "%02X ", request.address[i]);
+        }
+        pattern[ADDRESS_LENGTH * 3 - 1] = '\0';
+        ESP_LOGI(TAG, "Register scan of %s, xx from 0x%02X to 0x%02X, one read per %u ms", pattern, request.first,
+                 request.last, static_cast<unsigned>(request.interval_ms));
+    }
+}
+
+bool XGTBattery::scan_due_(uint32_t now) const {
+    // Only in cycles the pack answered, and not during a capture, which wants the bus for its rows
+    return this->scan_.interval_ms > 0 && this->scan_next_ <= this->scan_.last &&
+           this->poller_.cycle_responses() > 0 && !this->poller_.capture_active() && this->scan_cycle_reads_ < SCAN_READS_PER_CYCLE &&
+           (this->scan_sent_ == 0 || now - this->scan_last_time_ >= this->scan_.interval_ms);
+}
+
+RegisterRead XGTBattery::next_scan_read_(uint32_t now) {
+    RegisterRead pending{};
+    pending.request.assign(this->scan_.address, this->scan_.address + ADDRESS_LENGTH);
+    pending.request[this->scan_.index] = this->scan_next_;
+    pending.scan = true;
+    this->scan_next_ += this->scan_.step;
+    this->scan_last_time_ = now;
+    this->scan_cycle_reads_++;
+    this->scan_sent_++;
+    return pending;
+}
+
+void XGTBattery::send_read_(RegisterRead &&pending) {
+    uint8_t frame[MAX_FRAME_LENGTH];
+    uint8_t frame_length = SHORT_FRAME_LENGTH;
+    if (pending.long_frame) {
+        frame_length = encode_long_frame(pending.type, pending.request.data(), pending.request.size(), frame);
     } else {
-        // Short command: HALF DUPLEX MODE - no echo removal needed
-        // All received bytes are the actual response data
-        ESP_LOGV(TAG, "Processing as SHORT command in HALF DUPLEX mode - all %d bytes are response data", *rx_length);
-        
-        // Convert bit order from MSB first to LSB first (all received data is response)
-        for (uint8_t i = 0; i < *rx_length; ++i) {
-            buf[i] = (lookup_[buf[i] & 0b1111] << 4) | lookup_[buf[i] >> 4];
+        build_short_command(pending.request.data(), frame);
+    }
+    this->start_transaction(frame, frame_length, true, REG_READ, [this, pending = std::move(pending)](int8_t cmd_error, const uint8_t *buf, uint8_t length) mutable {
+        this->poller_.count_response(length);
+        pending.result = cmd_error;
+        pending.response.assign(buf, buf + length);
+        this->finish_read_(std::move(pending));
+        this->next_state_(STATE_READS);
+    });
+}
+
+void XGTBattery::finish_read_(RegisterRead &&pending) {
+    std::string request = format_hex_pretty(pending.request.data(), pending.request.size());
+    if (pending.scan) {
+        if (pending.result != 1) {
+            this->scan_answered_++;
+            ESP_LOGI(TAG, "Register scan: %s answered %s%s", request.c_str(),
+                     format_hex_pretty(pending.response.data(), pending.response.size()).c_str(),
+                     pending.result == 0 ? "" : " (CRC error)");
+        }
+        if (this->scan_next_ > this->scan_.last) {
+            ESP_LOGI(TAG, "Register scan finished: %u of %u addresses answered", this->scan_answered_,
+                     this->scan_sent_);
+            this->scan_.interval_ms = 0;
         }
+        if (pending.result == 1) {
+            return;  // Only addresses that answer are reported
+        }
+    } else {
+        ESP_LOGD(TAG, "Read %s: result %d, %u bytes", request.c_str(), pending.result,
+                 static_cast<unsigned>(pending.response.size()));
     }
-    
-    // Debug: Print response data AFTER bit reversal
-    ESP_LOGV(TAG, "After bit reversal, response %d bytes:", *rx_length);
-    for (uint8_t i = 0; i < *rx_length && i < 16; i++) {
-        ESP_LOGV(TAG, "  [%d] = 0x%02X", i, buf[i]);
+    std::lock_guard<std::mutex> guard(this->read_lock_);
+    this->read_ready_.push_back(std::move(pending));
+}
+
+void XGTBattery::deliver_reads_() {
+    std::vector<RegisterRead> ready;
+    {
+        std::lock_guard<std::mutex> guard(this->read_lock_);
+        if (this->read_ready_.empty()) {
+            return;
+        }
+        ready.swap(this->read_ready_);
     }
-    
-    // Check CRC
-    if (!this->check_crc(buf, *rx_length)) {
-        ESP_LOGW(TAG, "CRC check failed for %d byte message", *rx_length);
-        return -1;  // CRC error
+    for (auto &result : ready) {
+        this->register_read_callback_.call(std::move(result));
     }
-    
-    return 0;  // Success
 }
 
+void XGTBattery::take_snapshot_(uint32_t now) {
+    Snapshot &snapshot = this->snapshot_;
+    PackSnapshot &pack = snapshot.pack;
+    pack.time_ms = now;
+    pack.version = PACK_SNAPSHOT_VERSION;
+    const PackPoller &poller = this->poller_;
+    pack.cell_count = poller.cell_count();
+    pack.registers_valid = poller.good_registers();
+    pack.cells_valid = poller.good_cells();
+    memcpy(pack.raw, poller.raw_values(), sizeof(pack.raw));
+    memcpy(pack.cell_mv, poller.cell_values(), sizeof(pack.cell_mv));
+    for (uint8_t reg = 0; reg < REG_COUNT; reg++) {
+        pack.register_age_s[reg] = PackSnapshot::age_s(now, poller.last_good(reg));
+    }
+    for (uint8_t cell = 1; cell <= MAX_CELLS; cell++) {
+        pack.cell_age_s[cell - 1] = PackSnapshot::age_s(now, poller.cell_last_good(cell));
+    }
+    snapshot.pack_present = poller.pack_present();
+    snapshot.registers_decoded = poller.decoded_registers();
+    // With max_value_age, publish even without a response so stale values go unavailable
+    snapshot.publish_values = poller.cycle_responses() > 0 || this->max_value_age_ > 0;
+    snapshot.cycle_ms = now - this->cycle_start_time_;
+    snapshot.bus_wait_ms = this->bus_wait_ms_;
+    // last_update_ is still the end of the previous cycle
+    uint32_t period = now - this->last_update_;
+    snapshot.duty_cycle = period > 0 ? static_cast<float>(snapshot.cycle_ms) / period : 1.0f;
 
+    snapshot.publish_timing = this->adaptive_timing_;
+    if (this->adaptive_timing_) {
+        snapshot.response_time_ms = this->timing_.max_p99_onset_ms();
+        snapshot.response_timeout_ms = 0;
+        for (uint8_t reg = 0; reg < REG_COUNT; reg++) {
+            if (poller.needed_registers() & (1 << reg)) {
+                uint32_t reg_timeout = this->timing_.first_byte_timeout_ms(reg, SHORT_SETTLE_MS + SHORT_RX_TIMEOUT_MS);
+                snapshot.response_timeout_ms = reg_timeout > snapshot.response_timeout_ms ? reg_timeout
+                                                                                          : snapshot.response_timeout_ms;
+            }
+        }
+        snapshot.command_gap_ms = this->timing_.gap_ms(REGISTERS[REG_PACK_VOLTAGE].gap_ms);
+    }
 
-void XGTBattery::publish_sensors() {
-    if (this->battery_voltage_sensor_ != nullptr) {
-        this->battery_voltage_sensor_->publish_state(pack_voltage_);
+    // Latency is per cycle: hand it over and start collecting the next one
+    for (uint8_t index = 0; index <= REG_COUNT; index++) {
+        RegisterHealth &health = this->health_[index];
+        snapshot.health[index] = health;
+        health.latency_min = UINT32_MAX;
+        health.latency_max = 0;
+        health.latency_total = 0;
+        health.latency_samples = 0;
     }
-    
-    if (this->battery_temperature_sensor_ != nullptr) {
-        this->battery_temperature_sensor_->publish_state(temperature_);
+}
+
+void XGTBattery::publish_snapshot_(const Snapshot &snapshot) {
+    if (snapshot.publish_values) {
+        this->publish_sensors(snapshot);
+#ifdef USE_XGT_BATTERY_HISTORY
+        if (this->history_enabled_()) {
+            this->record_history_(snapshot);
+        }
+#endif
     }
-    
-    if (this->battery_charge_sensor_ != nullptr) {
-        this->battery_charge_sensor_->publish_state(charge_);
+    if (this->pack_connected_binary_sensor_ != nullptr) {
+        this->pack_connected_binary_sensor_->publish_state(snapshot.pack_present);
     }
-    
-    if (this->battery_health_sensor_ != nullptr) {
-        this->battery_health_sensor_->publish_state(batt_health_);
+    if (snapshot.publish_timing) {
+        this->publish_timing_(snapshot);
     }
-    
+    if (this->bus_wait_sensor_ != nullptr) {
+        this->publish_state_(this->bus_wait_sensor_, snapshot.bus_wait_ms);
+    }
+    if (this->duty_cycle_sensor_ != nullptr) {
+        this->publish_state_(this->duty_cycle_sensor_, snapshot.duty_cycle * 100.0f);
+    }
+    if (this->average_current_sensor_ != nullptr) {
+        this->publish_state_(this->average_current_sensor_, snapshot.duty_cycle * this->active_current_ +
+                                                                (1.0f - snapshot.duty_cycle) * this->idle_current_);
+    }
+    this->publish_health_(snapshot);
+}
 
-    
-    if (this->num_charges_sensor_ != nullptr) {
-        this->num_charges_sensor_->publish_state(num_charges_);
+#ifdef USE_XGT_BATTERY_HISTORY
+void XGTBattery::record_history_(const Snapshot &snapshot) {
+    // Same freshness rules as the sensors; a channel that would publish unavailable is left out
+    uint32_t now = millis();
+    HistorySample sample{snapshot.pack.time_ms, 0, {0}};
+    for (uint8_t i = 0; i < HISTORY_CELLS; i++) {
+        if (this->is_cell_fresh_(snapshot, i, now)) {
+            sample.values[i] = snapshot.pack.cell_mv[i];
+            sample.valid |= 1 << i;
+        }
     }
-    
-    if (this->cell_size_sensor_ != nullptr) {
-        this->cell_size_sensor_->publish_state(cell_size_);
+    static const uint8_t CHANNELS[][2] = {{HISTORY_PACK_VOLTAGE, REG_PACK_VOLTAGE},
+                                          {HISTORY_TEMPERATURE, REG_TEMPERATURE}};
+    for (const auto &channel : CHANNELS) {
+        uint8_t reg = channel[1];
+        if ((snapshot.pack.registers_valid & (1 << reg)) && this->is_fresh_(snapshot, reg, now)) {
+            sample.values[channel[0]] = snapshot.pack.raw[reg];
+            sample.valid |= 1 << channel[0];
+        }
     }
-    
-    if (this->parallel_count_sensor_ != nullptr) {
-        this->parallel_count_sensor_->publish_state(parallel_cnt_);
+    if (sample.valid == 0) {
+        return;  // No pack
+    }
+    std::lock_guard<std::mutex> guard(this->history_lock_);
+    this->history_.add(sample);
+}
+#endif
+
+void XGTBattery::publish_timing_(const Snapshot &snapshot) {
+    if (this->response_time_sensor_ != nullptr) {
+        this->publish_state_(this->response_time_sensor_, snapshot.response_time_ms);
+    }
+    if (this->response_timeout_sensor_ != nullptr) {
+        this->publish_state_(this->response_timeout_sensor_, snapshot.response_timeout_ms);
+    }
+    if (this->command_gap_sensor_ != nullptr) {
+        this->publish_state_(this->command_gap_sensor_, snapshot.command_gap_ms);
+    }
+}
+
+void XGTBattery::count_health_(HealthMetric metric) {
+    if (this->tx_register_ == REG_READ) {
+        return;  // Unknown registers not answering is expected, not a bus problem
+    }
+    if (this->tx_register_ < REG_COUNT) {
+        this->health_[this->tx_register_].counters[metric]++;
+    }
+    this->health_[REG_COUNT].counters[metric]++;
+}
+
+void XGTBattery::record_latency_(uint32_t latency_ms) {
+    if (this->tx_register_ == REG_READ) {
+        return;
+    }
+    for (uint8_t index : {this->tx_register_, static_cast<uint8_t>(REG_COUNT)}) {
+        RegisterHealth &health = this->health_[index];
+        health.latency_min = latency_ms < health.latency_min ? latency_ms : health.latency_min;
+        health.latency_max = latency_ms > health.latency_max ? latency_ms : health.latency_max;
+        health.latency_total += latency_ms;
+        health.latency_samples++;
+    }
+}
+
+void XGTBattery::record_failure_() {
+    if (this->tx_register_ == REG_READ || !this->adaptive_timing_) {
+        return;  // A scanned address not answering says nothing about the bus timing
+    }
+    this->timing_.record_failure(this->tx_register_);
+}
+
+void XGTBattery::publish_health_(const Snapshot &snapshot) {
+    if (this->cycle_time_sensor_ != nullptr) {
+        this->publish_state_(this->cycle_time_sensor_, snapshot.cycle_ms);
+    }
+    for (uint8_t index = 0; index <= REG_COUNT; index++) {
+        const RegisterHealth &health = snapshot.health[index];
+        sensor::Sensor **sensors = this->health_sensors_[index];
+        for (uint8_t metric = 0; metric < HEALTH_COUNTER_COUNT; metric++) {
+            if (sensors[metric] != nullptr) {
+                this->publish_state_(sensors[metric], health.counters[metric]);
+            }
+        }
+        // Registers not polled this cycle keep their last latency
+        if (health.latency_samples == 0) {
+            continue;
+        }
+        if (sensors[HEALTH_LATENCY_MIN] != nullptr) {
+            this->publish_state_(sensors[HEALTH_LATENCY_MIN], health.latency_min);
+        }
+        if (sensors[HEALTH_LATENCY_AVG] != nullptr) {
+            this->publish_state_(sensors[HEALTH_LATENCY_AVG],
+                                 static_cast<float>(health.latency_total) / health.latency_samples);
+        }
+        if (sensors[HEALTH_LATENCY_MAX] != nullptr) {
+            this->publish_state_(sensors[HEALTH_LATENCY_MAX], health.latency_max);
+        }
+    }
+
+    const RegisterHealth &total = snapshot.health[REG_COUNT];
+    ESP_LOGV(TAG, "Cycle took %ums. Protocol health: %u ok, %u CRC errors, %u timeouts, %u retries, %u short frames",
+             snapshot.cycle_ms, total.counters[HEALTH_SUCCESS], total.counters[HEALTH_CRC_ERRORS],
+             total.counters[HEALTH_TIMEOUTS], total.counters[HEALTH_RETRIES], total.counters[HEALTH_SHORT_FRAMES]);
+}
+
+void XGTBattery::set_publish_policy(sensor::Sensor *sensor, float deadband, uint32_t heartbeat) {
+    this->publish_policies_.push_back({sensor, deadband, heartbeat, 0});
+}
+
+void XGTBattery::publish_state_(sensor::Sensor *sensor, float value) {
+    // Sensors with a deadband/heartbeat only publish on a real change or when the heartbeat is due;
+    // everything else publishes every cycle as before
+    for (auto &policy : this->publish_policies_) {
+        if (policy.sensor != sensor) {
+            continue;
+        }
+        uint32_t now = millis();
+        bool heartbeat_due = policy.heartbeat > 0 && now - policy.last_publish >= policy.heartbeat;
+        if (sensor->has_state() && !heartbeat_due) {
+            float last = sensor->get_raw_state();
+            bool changed = std::isnan(last) != std::isnan(value) ||
+                           (!std::isnan(value) && std::fabs(value - last) > policy.deadband);
+            if (!changed) {
+                return;
+            }
+        }
+        policy.last_publish = now;
+        break;
+    }
+    sensor->publish_state(value);
+}
+
+void XGTBattery::next_state_(DataState state) {
+    this->current_state_ = state;
+    this->state_start_time_ = millis();
+}
+
+uint32_t XGTBattery::value_lifetime_(uint8_t reg) const {
+    // One poll period of the register, one update interval for the cycle to come around, plus the allowed age
+    PollClass poll_class = this->poller_.poll_class(reg);
+    uint32_t period = poll_class == POLL_FAST ? 0 : this->poller_.class_interval(poll_class);
+    return period + this->update_interval_ + this->max_value_age_;
+}
+
+bool XGTBattery::is_fresh_(const Snapshot &snapshot, uint8_t reg, uint32_t now) const {
+    // Derived values are only as fresh as the registers they are computed from
+    uint16_t registers = (1 << reg) | REGISTERS[reg].depends_on;
+    if (this->max_value_age_ == 0) {
+        // Keep publishing the last value, but never one that was not read yet (0 would be -273.1 C)
+        return (snapshot.registers_decoded & registers) == registers;
+    }
+    for (uint8_t i = 0; i < REG_COUNT; i++) {
+        if ((registers & (1 << i)) &&
+            (!(snapshot.pack.registers_valid & (1 << i)) ||
+             snapshot.pack.register_age_ms(i, now) > this->value_lifetime_(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool XGTBattery::is_cell_fresh_(const Snapshot &snapshot, uint8_t cell, uint32_t now) const {
+    if (this->max_value_age_ == 0) {
+        return cell < snapshot.pack.cell_count;
+    }
+    return cell < snapshot.pack.cell_count && (snapshot.pack.cells_valid & (1 << cell)) &&
+           snapshot.pack.cell_age_ms(cell, now) <= this->value_lifetime_(REG_CELL_VOLTAGES);
+}
+
+void XGTBattery::publish_sensors(const Snapshot &snapshot) {
+    uint32_t now = millis();
+    // Without max_value_age a register that was not read yet is left out, with it stale values go unavailable
+    for (uint8_t reg = 0; reg < REG_COUNT; reg++) {
+        sensor::Sensor *sens = REGISTER_SENSORS[reg] != nullptr ? this->*REGISTER_SENSORS[reg] : nullptr;
+        if (sens == nullptr) {
+            continue;
+        }
+        if (this->is_fresh_(snapshot, reg, now)) {
+            this->publish_state_(sens, register_value(reg, snapshot.pack.raw));
+        } else if (this->max_value_age_ > 0) {
+            this->publish_state_(sens, NAN);
+        }
     }
     
-    // Publish cell voltages
+    // Publish cell voltages. Without max_value_age only the detected cells are published, with it
+    // missing and stale cells go unavailable.
     for (uint8_t i = 0; i < 10; i++) {
-        if (this->cell_voltage_sensors_[i] != nullptr) {
-            this->cell_voltage_sensors_[i]->publish_state(cell_voltages_[i]);
+        if (this->cell_voltage_sensors_[i] == nullptr) {
+            continue;
+        }
+        if (this->is_cell_fresh_(snapshot, i, now)) {
+            this->publish_state_(this->cell_voltage_sensors_[i], cell_voltage_(snapshot.pack.cell_mv[i]));
+        } else if (this->max_value_age_ > 0) {
+            this->publish_state_(this->cell_voltage_sensors_[i], NAN);
         }
     }
     
@@ -324,193 +1288,160 @@ void XGTBattery::publish_sensors() {
     float max_voltage = 0.0f;
     bool has_valid_cells = false;
     
-    for (uint8_t i = 0; i < 10; i++) {
-        if (cell_voltages_[i] > 0.0f) {  // Only consider valid (non-zero) cell voltages
-            has_valid_cells = true;
-            if (cell_voltages_[i] < min_voltage) {
-                min_voltage = cell_voltages_[i];
-            }
-            if (cell_voltages_[i] > max_voltage) {
-                max_voltage = cell_voltages_[i];
-            }
+    // Only the detected cells exist; until the count is known there is nothing meaningful to compare.
+    // A stale cell makes the statistics unavailable rather than quietly leaving it out.
+    bool all_fresh = true;
+    for (uint8_t i = 0; i < snapshot.pack.cell_count; i++) {
+        if (!this->is_cell_fresh_(snapshot, i, now)) {
+            all_fresh = false;
+            break;
+        }
+        float cell_voltage = cell_voltage_(snapshot.pack.cell_mv[i]);
+        has_valid_cells = true;
+        if (cell_voltage < min_voltage) {
+            min_voltage = cell_voltage;
+        }
+        if (cell_voltage > max_voltage) {
+            max_voltage = cell_voltage;
         }
     }
+    if (!all_fresh || (!has_valid_cells && this->max_value_age_ > 0)) {
+        has_valid_cells = true;
+        min_voltage = max_voltage = NAN;
+    }
     
     if (has_valid_cells) {
         if (this->min_cell_voltage_sensor_ != nullptr) {
-            this->min_cell_voltage_sensor_->publish_state(min_voltage);
+            this->publish_state_(this->min_cell_voltage_sensor_, min_voltage);
         }
         
         if (this->max_cell_voltage_sensor_ != nullptr) {
-            this->max_cell_voltage_sensor_->publish_state(max_voltage);
+            this->publish_state_(this->max_cell_voltage_sensor_, max_voltage);
         }
         
         if (this->cell_divergence_sensor_ != nullptr) {
             float divergence = max_voltage - min_voltage;
-            this->cell_divergence_sensor_->publish_state(divergence);
+            this->publish_state_(this->cell_divergence_sensor_, divergence);
         }
     }
     
-    ESP_LOGD(TAG, "Charge: %d%%, Health: %d%%, Temp: %.1f°C, Voltage: %.2fV, Charges: %d, CellSize: %dmAh, Parallel: %d, Cells: [%.3f %.3f %.3f %.3f %.3f %.3f %.3f %.3f %.3f %.3f]V", 
-             charge_, batt_health_, temperature_, pack_voltage_, num_charges_, cell_size_, parallel_cnt_,
-             cell_voltages_[0], cell_voltages_[1], cell_voltages_[2], cell_voltages_[3], cell_voltages_[4],
-             cell_voltages_[5], cell_voltages_[6], cell_voltages_[7], cell_voltages_[8], cell_voltages_[9]);
+    // Every value is on a sensor already; the full dump is only formatted at VERBOSE
+    XGT_TRACE_LOGV("Charge: %.0f%%, Health: %.0f%%, Temp: %.1f°C, Voltage: %.2fV, Charges: %.0f, CellSize: %.0fmAh, Parallel: %.0f, Cells: [%.3f %.3f %.3f %.3f %.3f %.3f %.3f %.3f %.3f %.3f]V", 
+                   register_value(REG_CHARGE, snapshot.pack.raw), register_value(REG_BATTERY_HEALTH, snapshot.pack.raw),
+                   register_value(REG_TEMPERATURE, snapshot.pack.raw), register_value(REG_PACK_VOLTAGE, snapshot.pack.raw),
+                   register_value(REG_NUM_CHARGES, snapshot.pack.raw), register_value(REG_CELL_SIZE, snapshot.pack.raw),
+                   register_value(REG_PARALLEL_COUNT, snapshot.pack.raw),
+                   cell_voltage_(snapshot.pack.cell_mv[0]), cell_voltage_(snapshot.pack.cell_mv[1]), cell_voltage_(snapshot.pack.cell_mv[2]), cell_voltage_(snapshot.pack.cell_mv[3]), cell_voltage_(snapshot.pack.cell_mv[4]),
+                   cell_voltage_(snapshot.pack.cell_mv[5]), cell_voltage_(snapshot.pack.cell_mv[6]), cell_voltage_(snapshot.pack.cell_mv[7]), cell_voltage_(snapshot.pack.cell_mv[8]), cell_voltage_(snapshot.pack.cell_mv[9]));
+}
+
+void XGTBattery::poll_step_(const PollStep &step) {
+    // Batches (step.reg = REG_COUNT) have no timing slot of their own and stay out of the per-register statistics
+    this->start_transaction(step.command, step.length, true, step.reg, [this](int8_t cmd_error, const uint8_t *buf, uint8_t length) {
+#ifdef XGT_BATTERY_TRACE_LOG
+        if (this->tx_register_ < REG_COUNT && is_short_frame(buf, length)) {
+            ESP_LOGV(TAG, "%s: error=%d, raw=%u", REGISTERS[this->tx_register_].name, cmd_error,
+                     REGISTERS[this->tx_register_].decode(buf));
+        }
+#endif
+        uint16_t events = this->poller_.handle(cmd_error, buf, length, millis());
+        if (events & POLL_EVENT_RETRY) {
+            this->count_health_(HEALTH_RETRIES);
+        }
+        this->log_poll_events_(events);
+        this->next_state_(STATE_REGISTERS);
+    });
+}
+
+void XGTBattery::log_poll_events_(uint16_t events) {
+    const PackPoller &poller = this->poller_;
+    if (events & POLL_EVENT_PACK_DETECTED) {
+        ESP_LOGI(TAG, "Battery pack detected");
+    }
+    if (events & POLL_EVENT_PACK_REMOVED) {
+        ESP_LOGI(TAG, "Battery pack removed, metadata will be re-read when a pack is detected");
+    }
+    if (events & POLL_EVENT_RETRY) {
+        ESP_LOGD(TAG, "Re-polling %s after a bad frame, %u retries left this cycle", REGISTERS[this->tx_register_].name,
+                 poller.retries_left());
+    }
+    if (events & POLL_EVENT_CELLS_NONE) {
+        ESP_LOGW(TAG, "No valid cell voltage received, cell count detection will be retried");
+    }
+    if ((events & POLL_EVENT_CELLS_MISMATCH) && poller.detect_pack_mv() == 0) {
+        ESP_LOGW(TAG, "%u cells found but the pack voltage was not read, cell count detection will be retried",
+                 poller.detect_count());
+    } else if (events & POLL_EVENT_CELLS_MISMATCH) {
+        ESP_LOGW(TAG, "%u cells sum to %umV but pack reads %umV, cell count detection will be retried",
+                 poller.detect_count(), static_cast<unsigned>(poller.detect_cells_mv()), poller.detect_pack_mv());
+    }
+    if (events & POLL_EVENT_CELLS_DETECTED) {
+        ESP_LOGI(TAG, "Detected %uS battery pack", poller.cell_count());
+    }
+    if (events & POLL_EVENT_BATCH_SUPPORTED) {
+        ESP_LOGI(TAG, "Pack supports batched reads");
+    }
+    if (events & POLL_EVENT_BATCH_UNSUPPORTED) {
+        ESP_LOGI(TAG, "Pack does not answer batched reads, using short commands");
+    }
+    if (events & POLL_EVENT_BATCH_FAILED) {
+        ESP_LOGD(TAG, "Batched read failed, using short commands for the rest of this cycle");
+    }
+    if (events & POLL_EVENT_WEAKEST_CELL) {
+        ESP_LOGD(TAG, "Capturing cell %u, the weakest", poller.capture_cell());
+    }
 }
 
 void XGTBattery::process_current_state() {
     uint32_t now = millis();
-    int8_t cmd_error = 0;
     
     switch (current_state_) {
         case STATE_WAKE:
             if (now - state_start_time_ >= 10) {  // Quick transition to wake
-                // Send wake byte using ESPHome UART methods
-                ESP_LOGV(TAG, "Sending wake byte 0x0 to battery");
-                uint8_t wake_byte = 0x0;
-                this->write(wake_byte);
-                this->flush();
-                delay(70);  // 70ms delay like working implementation
-                
-                current_state_ = STATE_NUM_CHARGES;
-                state_start_time_ = now;
-            }
-            break;
-            
-
-            
-        case STATE_NUM_CHARGES:
-            if (now - state_start_time_ >= 100) {  // Longer delay to prevent response mixing
-                cmd_error = this->send_battery(command_buffer_, num_charges_cmd_, sizeof(num_charges_cmd_), &rx_length_);
-                ESP_LOGV(TAG, "Num charges command: error=%d, rx_length=%d", cmd_error, rx_length_);
-                if (rx_length_ >= 8) {  // Process data regardless of CRC error, like working implementation
-                    num_charges_ = __builtin_bswap16((command_buffer_[4] << 8) | command_buffer_[5]);
-                    ESP_LOGV(TAG, "Num charges: buffer[4]=%02X, buffer[5]=%02X, result=%d", command_buffer_[4], command_buffer_[5], num_charges_);
-                }
-                current_state_ = STATE_CELL_SIZE;
-                state_start_time_ = now;
+                XGT_TRACE_LOGV("Sending wake byte 0x0 to battery");
+                // Completes after the 70ms wake settle time, without a response
+                this->start_transaction(&WAKE_BYTE, 1, false, REG_COUNT, [this](int8_t, const uint8_t *, uint8_t) {
+                    this->next_state_(STATE_REGISTERS);
+                });
             }
             break;
             
-        case STATE_CELL_SIZE:
-            if (now - state_start_time_ >= 100) {  // Longer delay to prevent response mixing
-                cmd_error = this->send_battery(command_buffer_, cell_size_cmd_, sizeof(cell_size_cmd_), &rx_length_);
-                if (rx_length_ >= 8) {
-                    // Extract raw value like INO file, but apply scaling for mAh units
-                    uint16_t raw_cell_size = command_buffer_[5];
-                    cell_size_ = raw_cell_size * 100;  // Scale: 40 raw -> 4000mAh for 4Ah battery
-                    ESP_LOGV(TAG, "Cell size: buffer[5]=%02X, raw=%d, scaled=%dmAh", command_buffer_[5], raw_cell_size, cell_size_);
-                }
-                current_state_ = STATE_PARALLEL_COUNT;
-                state_start_time_ = now;
-            }
-            break;
-            
-        case STATE_PARALLEL_COUNT:
-            if (now - state_start_time_ >= 50) {
-                cmd_error = this->send_battery(command_buffer_, parallel_cnt_cmd_, sizeof(parallel_cnt_cmd_), &rx_length_);
-                if (rx_length_ >= 8) {
-                    // Match INO file exactly: use buffer[4] directly
-                    parallel_cnt_ = command_buffer_[4];  // Read actual value from battery
-                    ESP_LOGV(TAG, "Parallel count: buffer[4]=%02X, result=%d (from battery)", command_buffer_[4], parallel_cnt_);
-                }
-                current_state_ = STATE_BATTERY_HEALTH;
-                state_start_time_ = now;
-            }
-            break;
-            
-        case STATE_BATTERY_HEALTH:
-            if (now - state_start_time_ >= 50) {
-                cmd_error = this->send_battery(command_buffer_, batt_health_cmd_, sizeof(batt_health_cmd_), &rx_length_);
-                if (rx_length_ >= 8) {
-                    uint16_t health_raw = __builtin_bswap16((command_buffer_[4] << 8) | command_buffer_[5]);
-                    // Match INO file exactly: use raw cell size (not scaled) for health calculation
-                    uint16_t raw_cell_size = cell_size_ / 100;  // Convert back to raw value (4000 -> 40)
-                    if (raw_cell_size > 0 && parallel_cnt_ > 0) {
-                        batt_health_ = health_raw / (raw_cell_size * parallel_cnt_);
-                        ESP_LOGV(TAG, "Battery health (INO method): raw=%d, raw_cell_size=%d, parallel_cnt=%d, result=%d%%", health_raw, raw_cell_size, parallel_cnt_, batt_health_);
-                    } else {
-                        // Fallback if values are invalid
-                        batt_health_ = (health_raw * 100) / 255;
-                        ESP_LOGV(TAG, "Battery health (fallback): raw=%d, result=%d%%", health_raw, batt_health_);
-                    }
-                }
-                current_state_ = STATE_CHARGE;
-                state_start_time_ = now;
+        case STATE_REGISTERS: {
+            const PollStep *step = this->poller_.next();
+            if (step == nullptr) {
+                // Table done. If its first command found no pack, the reads would only time out as well.
+                current_state_ = this->poller_.cycle_absent() ? STATE_COMPLETE : STATE_READS;
+                break;
             }
-            break;
-            
-        case STATE_CHARGE:
-            if (now - state_start_time_ >= 50) {
-                cmd_error = this->send_battery(command_buffer_, charge_cmd_, sizeof(charge_cmd_), &rx_length_);
-                if (rx_length_ >= 8) {
-                    uint16_t charge_raw = __builtin_bswap16((command_buffer_[4] << 8) | command_buffer_[5]);
-                    charge_ = charge_raw / 255;  // Convert to percentage (0-100) - matches working implementation
-                    ESP_LOGV(TAG, "Charge: raw=%d, result=%d%%", charge_raw, charge_);
-                }
-                current_state_ = STATE_TEMPERATURE;
-                state_start_time_ = now;
-            }
-            break;
-            
-        case STATE_TEMPERATURE:
-            if (now - state_start_time_ >= 50) {
-                cmd_error = this->send_battery(command_buffer_, temperature_cmd_, sizeof(temperature_cmd_), &rx_length_);
-                if (rx_length_ >= 8) {
-                    uint16_t temp_raw = __builtin_bswap16((command_buffer_[4] << 8) | command_buffer_[5]);
-                    temperature_ = -30 + ((temp_raw - 2431) / 10);  // Integer division like working implementation
-                    ESP_LOGV(TAG, "Temperature: raw=%d, result=%.1f°C", temp_raw, temperature_);
-                }
-                current_state_ = STATE_PACK_VOLTAGE;
-                state_start_time_ = now;
+            if (now - state_start_time_ >= this->command_gap_(step->gap_ms)) {  // Delay to prevent response mixing
+                this->poll_step_(*step);
             }
             break;
+        }
             
-        case STATE_PACK_VOLTAGE:
-            if (now - state_start_time_ >= 50) {
-                cmd_error = this->send_battery(command_buffer_, pack_voltage_cmd_, sizeof(pack_voltage_cmd_), &rx_length_);
-                ESP_LOGV(TAG, "Pack voltage command: error=%d, rx_length=%d", cmd_error, rx_length_);
-                if (rx_length_ >= 8) {  // Process data regardless of CRC error
-                    uint16_t voltage_raw = __builtin_bswap16((command_buffer_[4] << 8) | command_buffer_[5]);
-                    pack_voltage_ = voltage_raw / 1000.0;
-                    ESP_LOGV(TAG, "Pack voltage: buffer[4]=%02X, buffer[5]=%02X, raw=%d, result=%.2fV", 
-                             command_buffer_[4], command_buffer_[5], voltage_raw, pack_voltage_);
-                }
-                current_state_ = STATE_CELL_VOLTAGES;
-                current_cell_ = 1;  // Start with cell 1
-                state_start_time_ = now;
+        case STATE_READS:
+            if (this->cycle_reads_.empty() && !this->scan_due_(now)) {
+                current_state_ = STATE_COMPLETE;
+                break;
             }
-            break;
-            
-        case STATE_CELL_VOLTAGES:
-            if (now - state_start_time_ >= 50) {  // Add delay for cell voltage commands too
-                if (current_cell_ <= 10) {
-                    uint8_t cell_voltages_cmd_copy[8];
-                    memcpy(cell_voltages_cmd_copy, cell_voltages_cmd_, 8);
-                    cell_voltages_cmd_copy[4] = (lookup_[current_cell_ * 2 & 0b1111] << 4) | (lookup_[current_cell_ * 2 >> 4]);
-                    cell_voltages_cmd_copy[1] = (lookup_[current_cell_ * 2 + 194 & 0b1111] << 4) | (lookup_[current_cell_ * 2 + 194 >> 4]);
-                    
-                    cmd_error = this->send_battery(command_buffer_, cell_voltages_cmd_copy, 8, &rx_length_);
-                    if (rx_length_ >= 8) {
-                        uint16_t cell_voltage_raw = __builtin_bswap16((command_buffer_[4] << 8) | command_buffer_[5]);
-                        cell_voltages_[current_cell_ - 1] = cell_voltage_raw / 1000.0;
-                        ESP_LOGV(TAG, "Cell %d voltage: raw=%d, result=%.3fV", current_cell_, cell_voltage_raw, cell_voltages_[current_cell_ - 1]);
-                    }
-                    current_cell_++;
-                    state_start_time_ = now;  // Reset timer for next cell
+            if (now - state_start_time_ >= READ_GAP_MS) {
+                if (!this->cycle_reads_.empty()) {
+                    RegisterRead pending = std::move(this->cycle_reads_.front());
+                    this->cycle_reads_.erase(this->cycle_reads_.begin());
+                    this->send_read_(std::move(pending));
                 } else {
-                    current_state_ = STATE_COMPLETE;
+                    this->send_read_(this->next_scan_read_(now));
                 }
             }
             break;
-            
+
         case STATE_COMPLETE:
-            this->publish_sensors();
-            current_state_ = STATE_IDLE;
-            this->last_update_ = now;
+            this->finish_cycle_(now);
             break;
             
         default:
             current_state_ = STATE_IDLE;
+            this->high_freq_.stop();
             break;
     }
 }
@@ -1,14 +1,78 @@
 #pragma once
 
+#include "esphome/core/automation.h"
 #include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
 #include "esphome/components/uart/uart.h"
+#include "esphome/components/binary_sensor/binary_sensor.h"
 #include "esphome/components/sensor/sensor.h"
 #include "esphome/components/text_sensor/text_sensor.h"
+#ifdef USE_XGT_BATTERY_LIGHT_SLEEP
+#include <esp_pm.h>
+#endif
+#include "xgt_bus.h"
+#include "xgt_history.h"
+#include "xgt_poller.h"
+#include "xgt_protocol.h"
+#include "xgt_seqlock.h"
+#include "xgt_snapshot.h"
+#include "xgt_timing.h"
+#include "xgt_trace.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace esphome {
 namespace xgt_battery {
 
+static_assert(REG_COUNT == SNAPSHOT_REGISTERS, "PackSnapshot holds one raw value per register");
+
+// Protocol health metrics, kept per register and for the whole bus
+enum HealthMetric : uint8_t {
+  HEALTH_SUCCESS = 0,
+  HEALTH_CRC_ERRORS,
+  HEALTH_TIMEOUTS,      // No byte received, after all attempts
+  HEALTH_RETRIES,       // Commands re-sent after a failed attempt
+  HEALTH_SHORT_FRAMES,  // Some bytes, but less than a short frame
+  HEALTH_COUNTER_COUNT,
+  // Transaction latency (command start to validated frame) over the last cycle
+  HEALTH_LATENCY_MIN = HEALTH_COUNTER_COUNT,
+  HEALTH_LATENCY_AVG,
+  HEALTH_LATENCY_MAX,
+  HEALTH_METRIC_COUNT,
+};
+
+// One row of a live capture: the captured registers, read back to back from time_ms on
+struct CaptureSample {
+  uint32_t time_ms;
+  uint16_t raw[REG_COUNT];  // As decoded, raw[REG_CELL_VOLTAGES] is the captured cell
+  uint16_t valid;           // (1 << Register) bits read with a good CRC in this row
+  uint8_t cell;             // 1..10, 0 without a cell
+};
+
+// A read outside the register table, from read_register() or the register scan
+struct RegisterRead {
+  std::vector<uint8_t> request;  // Short read: the register address (ADDRESS_LENGTH bytes). Long frame: its payload
+  bool long_frame;
+  uint8_t type;                   // Long frame type
+  bool scan;                      // Sent by the register scan
+  int8_t result;                  // 0 = ok, 1 = short/no response, -1 = CRC error
+  std::vector<uint8_t> response;  // As received, bit order converted (memory order), framing included
+  // Bytes 4..5 of a short response as little endian, how most registers are decoded; 0 for other frames
+  uint16_t value() const {
+    return is_short_frame(this->response.data(), this->response.size()) ? decode_le16(this->response.data()) : 0;
+  }
+};
+
+// tx_register_ of read_register() and scan transactions: kept out of the health statistics, adaptive
+// timing and presence detection, which describe the register table
+static const uint8_t REG_READ = REG_COUNT + 1;
+
 class XGTBattery : public Component, public uart::UARTDevice {
  public:
   void setup() override;
@@ -24,6 +88,10 @@ class XGTBattery : public Component, public uart::UARTDevice {
   void set_max_cell_voltage_sensor(sensor::Sensor *sensor) { max_cell_voltage_sensor_ = sensor; }
   void set_cell_divergence_sensor(sensor::Sensor *sensor) { cell_divergence_sensor_ = sensor; }
 
+  void set_pack_connected_binary_sensor(binary_sensor::BinarySensor *binary_sensor) {
+    pack_connected_binary_sensor_ = binary_sensor;
+  }
+
   void set_num_charges_sensor(sensor::Sensor *sensor) { num_charges_sensor_ = sensor; }
   void set_cell_size_sensor(sensor::Sensor *sensor) { cell_size_sensor_ = sensor; }
   void set_parallel_count_sensor(sensor::Sensor *sensor) { parallel_count_sensor_ = sensor; }
@@ -35,7 +103,99 @@ class XGTBattery : public Component, public uart::UARTDevice {
     }
   }
 
+  void set_response_time_sensor(sensor::Sensor *sensor) { response_time_sensor_ = sensor; }
+  void set_response_timeout_sensor(sensor::Sensor *sensor) { response_timeout_sensor_ = sensor; }
+  void set_command_gap_sensor(sensor::Sensor *sensor) { command_gap_sensor_ = sensor; }
+  void set_cycle_time_sensor(sensor::Sensor *sensor) { cycle_time_sensor_ = sensor; }
+  void set_bus_wait_sensor(sensor::Sensor *sensor) { bus_wait_sensor_ = sensor; }
+  void set_duty_cycle_sensor(sensor::Sensor *sensor) { duty_cycle_sensor_ = sensor; }
+  void set_average_current_sensor(sensor::Sensor *sensor) { average_current_sensor_ = sensor; }
+  // reg = REG_COUNT for the bus totals
+  void set_health_sensor(Register reg, HealthMetric metric, sensor::Sensor *sensor) {
+    if (reg <= REG_COUNT && metric < HEALTH_METRIC_COUNT) {
+      health_sensors_[reg][metric] = sensor;
+    }
+  }
+
+  // Publish only when the value moves by more than deadband, or at least every heartbeat ms (0 = never)
+  void set_publish_policy(sensor::Sensor *sensor, float deadband, uint32_t heartbeat);
+
+  // Live capture: poll only registers ((1 << Register) bits) and cell (0 = none, 1..10 or CAPTURE_WEAKEST_CELL)
+  // back to back for duration_ms, then resume normal polling. Rows are delivered in batches of batch_size
+  // to the capture callbacks, from loop(). duration_ms = 0 stops a running capture.
+  void start_capture(uint16_t registers, uint8_t cell, uint32_t duration_ms, uint8_t batch_size);
+  void add_on_capture_callback(std::function<void(std::vector<CaptureSample>)> &&callback) {
+    capture_callback_.add(std::move(callback));
+  }
+  // Scaled value of a captured register, NAN if it was not read in that row
+  static float capture_value(const CaptureSample &sample, Register reg);
+
+  // Read any register without reflashing: a short read of request as register address, or with long_frame a
+  // long frame of type carrying request as payload, both given as hex ("C0 03 00 00"). Queued and sent at the
+  // end of a cycle that starts right away; the result goes to the register read callbacks from loop().
+  // False if request is not hex, does not fit the frame or the queue is full.
+  bool read_register(const std::string &request, bool long_frame = false, uint8_t type = 0);
+  // Register scan: short reads of address (hex) with address byte index swept from first to last in steps
+  // of step, at most one every interval_ms and SCAN_READS_PER_CYCLE per cycle, sent at the end of cycles
+  // in which the pack answered. Addresses that answer go to the register read callbacks. A new scan
+  // replaces a running one; interval_ms = 0 stops it.
+  void scan_registers(const std::string &address, uint8_t index, uint8_t first, uint8_t last, uint8_t step,
+                      uint32_t interval_ms);
+  void add_on_register_read_callback(std::function<void(RegisterRead)> &&callback) {
+    register_read_callback_.add(std::move(callback));
+  }
+
+  // Ring size of the binary frame trace (trace: ring)
+  void set_trace_size(uint8_t trace_size) { trace_size_ = trace_size; }
+  // Log the recorded frames, oldest first: readable, or as the hex-encoded binary blob for tools/xgt_replay
+  void dump_trace(bool binary = false);
+
+  // Packs sharing a UART share one bus; select_pin is driven high while this pack owns it
+  void set_bus(XGTBus *bus) {
+    bus_ = bus;
+    bus->add_member();
+  }
+  void set_select_pin(GPIOPin *select_pin) { select_pin_ = select_pin; }
+  // Run the acquisition in its own task pinned to core (USE_XGT_BATTERY_TASK), loop() only publishes
+  void set_polling_task(uint8_t core, uint8_t priority) {
+    task_core_ = core;
+    task_priority_ = priority;
+    use_task_ = true;
+  }
+
   void set_update_interval(uint32_t update_interval) { update_interval_ = update_interval; }
+  // While no pack answers, double the cycle interval per absent cycle up to this (0 = no backoff)
+  void set_absent_backoff(uint32_t absent_backoff) { absent_backoff_ = absent_backoff; }
+  // Hold power management locks only while a cycle runs, so the chip can light-sleep in between
+  void set_light_sleep(bool light_sleep) { light_sleep_ = light_sleep; }
+  // Current draw (mA) while a cycle runs and in between, for the average_current estimate
+  void set_current_model(float active_current, float idle_current) {
+    active_current_ = active_current;
+    idle_current_ = idle_current;
+  }
+  // Samples kept per history tier: every cycle, 1 minute and 15 minute averages (USE_XGT_BATTERY_HISTORY)
+  void set_history(uint16_t raw, uint16_t minute, uint16_t quarter_hour) {
+    history_samples_[0] = raw;
+    history_samples_[1] = minute;
+    history_samples_[2] = quarter_hour;
+  }
+#ifdef USE_XGT_BATTERY_HISTORY
+  // Calls f(const HistoryTier &) with the history locked, from any task. Keep f short (copy, do not format):
+  // the polling cycle waits for the lock to record its sample.
+  template<typename F> void read_history(uint8_t tier, F f) {
+    std::lock_guard<std::mutex> guard(this->history_lock_);
+    f(this->history_.tier(tier));
+  }
+#endif
+  void set_adaptive_timing(bool adaptive_timing) { adaptive_timing_ = adaptive_timing; }
+  void set_timing_margin(uint32_t timing_margin) { timing_margin_ = timing_margin; }
+  void set_strict_crc(bool strict_crc) { poller_.set_strict_crc(strict_crc); }
+  void set_batch_reads(bool batch_reads) { poller_.set_batch_reads(batch_reads); }
+  void set_retry_budget(uint8_t retry_budget) { poller_.set_retry_budget(retry_budget); }
+  void set_max_value_age(uint32_t max_value_age) { max_value_age_ = max_value_age; }
+  void set_slow_interval(uint32_t slow_interval) { poller_.set_class_interval(POLL_SLOW, slow_interval); }
+  void set_static_interval(uint32_t static_interval) { poller_.set_class_interval(POLL_STATIC, static_interval); }
+  void set_poll_class(Register reg, PollClass poll_class) { poller_.set_poll_class(reg, poll_class); }
 
  protected:
   sensor::Sensor *battery_voltage_sensor_{nullptr};
@@ -46,63 +206,351 @@ class XGTBattery : public Component, public uart::UARTDevice {
   sensor::Sensor *max_cell_voltage_sensor_{nullptr};
   sensor::Sensor *cell_divergence_sensor_{nullptr};
 
+  binary_sensor::BinarySensor *pack_connected_binary_sensor_{nullptr};
+
   sensor::Sensor *num_charges_sensor_{nullptr};
   sensor::Sensor *cell_size_sensor_{nullptr};
   sensor::Sensor *parallel_count_sensor_{nullptr};
   sensor::Sensor *cell_voltage_sensors_[10]{nullptr};
 
+  sensor::Sensor *response_time_sensor_{nullptr};
+  sensor::Sensor *response_timeout_sensor_{nullptr};
+  sensor::Sensor *command_gap_sensor_{nullptr};
+  sensor::Sensor *cycle_time_sensor_{nullptr};
+  sensor::Sensor *bus_wait_sensor_{nullptr};
+  sensor::Sensor *duty_cycle_sensor_{nullptr};
+  sensor::Sensor *average_current_sensor_{nullptr};
+  sensor::Sensor *health_sensors_[REG_COUNT + 1][HEALTH_METRIC_COUNT]{};
+
+  struct PublishPolicy {
+    sensor::Sensor *sensor;
+    float deadband;
+    uint32_t heartbeat;
+    uint32_t last_publish;
+  };
+  std::vector<PublishPolicy> publish_policies_;
+
   uint32_t update_interval_{10000};  // Default 10 seconds
   uint32_t last_update_{0};
-  
+
+  // Shared bus arbitration: a due cycle waits until the bus grants this pack
+  XGTBus *bus_{nullptr};
+  GPIOPin *select_pin_{nullptr};
+  bool bus_waiting_{false};
+  uint32_t bus_wait_start_{0};
+  uint32_t bus_wait_ms_{0};
+
+  // Presence: a cycle whose first command gets no byte at all ends there, and cycles back off while absent
+  bool start_now_{true};  // Start the next cycle without waiting for the interval: after boot and a capture
+  uint32_t absent_backoff_{0};
+
+  // Duty cycle: light sleep between cycles, and an estimate of the resulting average current
+  bool light_sleep_{false};
+  float active_current_{40.0f};
+  float idle_current_{1.0f};
+#ifdef USE_XGT_BATTERY_LIGHT_SLEEP
+  esp_pm_lock_handle_t pm_apb_lock_{nullptr};
+  esp_pm_lock_handle_t pm_sleep_lock_{nullptr};
+#endif
+
+  // Cycle sequence, cell detection, presence and the value cache (xgt_poller.h); this class does the I/O
+  PackPoller poller_;
+  // Sensor of each REGISTERS row, nullptr for registers with their own publish logic
+  static sensor::Sensor *XGTBattery::*const REGISTER_SENSORS[REG_COUNT];
+
   // State machine for non-blocking operation
   enum DataState {
     STATE_IDLE,
     STATE_WAKE,
-    STATE_NUM_CHARGES,
-    STATE_CELL_SIZE,
-    STATE_PARALLEL_COUNT,
-    STATE_BATTERY_HEALTH,
-    STATE_CHARGE,
-    STATE_TEMPERATURE,
-    STATE_PACK_VOLTAGE,
-    STATE_CELL_VOLTAGES,
+    STATE_REGISTERS,
+    STATE_READS,  // read_register() and scan reads, after the table so they never delay the sensors
     STATE_COMPLETE
   };
   
   DataState current_state_{STATE_IDLE};
   uint32_t state_start_time_{0};
-  uint8_t current_cell_{0};
   uint8_t command_buffer_[32]{0};
   uint8_t rx_length_{0};
+
+  // Transaction engine: TX -> settle -> RX collect -> validate, advanced from loop() without blocking.
+  // The callback receives the send_battery() style result (0 = ok, 1 = short/no response, -1 = CRC error)
+  // together with the bit-reversed response buffer.
+  using TransactionCallback = std::function<void(int8_t error, const uint8_t *buf, uint8_t length)>;
+
+  enum TransactionPhase {
+    TX_IDLE,
+    TX_SENDING,
+    TX_SETTLE,
+    TX_RECEIVE,
+    TX_RETRY_WAIT,
+  };
+
+  TransactionPhase tx_phase_{TX_IDLE};
+  uint32_t tx_phase_start_{0};
+  uint32_t tx_phase_duration_{0};
+  uint8_t tx_command_[32]{0};
+  uint8_t tx_cmd_length_{0};
+  uint8_t tx_attempts_{0};
+  uint8_t tx_register_{REG_COUNT};  // Register being polled, REG_COUNT for the wake byte
+  uint32_t tx_end_time_{0};         // When the command finished on the wire
+  uint32_t rx_last_byte_time_{0};
+
+  // Learned response onset per register, shrinking timeouts and gaps toward observed p99 + margin
+  AdaptiveTiming timing_;
+  bool adaptive_timing_{false};
+  uint32_t timing_margin_{5};
+  bool tx_expect_response_{true};
+  TransactionCallback tx_callback_;
+  HighFrequencyLoopRequester high_freq_;
   
-  // Battery data storage
-  uint16_t batt_health_ = 0;
-  uint16_t cell_size_ = 0;
-  uint16_t parallel_cnt_ = 0;
-  uint16_t charge_ = 0;
-  uint16_t num_charges_ = 0;
-  float temperature_ = 0;
-  float pack_voltage_ = 0;
-  float cell_voltages_[10] = {0};
-
-
-  // Protocol commands
-  static const uint8_t num_charges_cmd_[8];
-  static const uint8_t cell_size_cmd_[8];
-  static const uint8_t parallel_cnt_cmd_[8];
-  static const uint8_t batt_health_cmd_[8];
-  static const uint8_t charge_cmd_[8];
-  static const uint8_t temperature_cmd_[8];
-  static const uint8_t pack_voltage_cmd_[8];
-  static const uint8_t cell_voltages_cmd_[8];
-  static const uint8_t lookup_[16];
+  // Protocol health per register, bus totals at index REG_COUNT. Counters run since boot, latency is
+  // collected over one cycle and reset when published.
+  struct RegisterHealth {
+    uint32_t counters[HEALTH_COUNTER_COUNT]{0};
+    uint32_t latency_min{UINT32_MAX};
+    uint32_t latency_max{0};
+    uint32_t latency_total{0};
+    uint16_t latency_samples{0};
+  };
+  RegisterHealth health_[REG_COUNT + 1];
+  uint32_t tx_start_time_{0};     // First attempt of the running transaction, for latency
+  uint32_t cycle_start_time_{0};
+
+  // Everything published after a cycle, copied out of the acquisition state below. Publishing reads only
+  // the snapshot, so with polling_task loop() never touches what the acquisition task is writing.
+  struct Snapshot {
+    PackSnapshot pack;
+    bool pack_present;
+    uint16_t registers_decoded;  // (1 << register): a value was decoded from this pack, see PackPoller
+    bool publish_values;  // A frame arrived, or stale values have to go unavailable
+    bool publish_timing;
+    uint32_t cycle_ms;
+    uint32_t bus_wait_ms;
+    float duty_cycle;  // Share of the time since the previous cycle spent in this cycle, 0..1
+    uint32_t response_time_ms;
+    uint32_t response_timeout_ms;
+    uint32_t command_gap_ms;
+    RegisterHealth health[REG_COUNT + 1];
+  };
+  Snapshot snapshot_{};
+
+  // Polling task: the task owns the bus and all acquisition state, and hands finished snapshots to loop()
+  bool use_task_{false};
+  uint8_t task_core_{1};
+  uint8_t task_priority_{5};
+#ifdef USE_XGT_BATTERY_TASK
+  SeqLock<Snapshot> handoff_;
+  uint32_t handoff_seq_{0};
+  Snapshot published_{};
+  std::atomic<uint8_t> trace_request_{0};  // dump_trace() from loop(): 1 = text, 2 = binary
+  uint8_t uart_num_{0};                     // ESP-IDF UART port, for waiting on the driver (wait_rx_)
+  static void polling_task_(void *param);
+  uint32_t next_step_ms_(uint32_t now) const;
+  void wait_rx_();
+#endif
+
+  // Live capture. The request comes from loop(), the rows are collected by whoever runs the acquisition,
+  // and finished batches go back to loop() for the callbacks; capture_lock_ guards the hand-over both ways.
+  struct CaptureRequest {
+    uint16_t registers;
+    uint8_t cell;
+    uint32_t duration_ms;
+    uint8_t batch_size;
+  };
+  std::mutex capture_lock_;
+  std::atomic<bool> capture_pending_{false};
+  CaptureRequest capture_request_{};
+  std::vector<std::vector<CaptureSample>> capture_ready_;
+  CallbackManager<void(std::vector<CaptureSample>)> capture_callback_;
+  // Acquisition side; what a row polls is set on the poller
+  uint32_t capture_start_{0};
+  uint32_t capture_duration_{0};
+  uint8_t capture_batch_size_{0};
+  std::vector<CaptureSample> capture_batch_;
+  void apply_capture_request_(uint32_t now);
+  void record_capture_(uint32_t now);
+  void flush_capture_();
+  void end_capture_();
+  void deliver_captures_();
+
+  // Register reads and scan. Requests come from loop(), reads are sent by whoever runs the acquisition,
+  // and results go back to loop() for the callbacks; read_lock_ guards the hand-over both ways.
+  struct ScanRequest {
+    uint8_t address[ADDRESS_LENGTH];
+    uint8_t index;
+    uint8_t first;
+    uint8_t last;
+    uint8_t step;
+    uint32_t interval_ms;  // 0 = no scan
+  };
+  std::mutex read_lock_;
+  std::atomic<bool> read_pending_{false};  // Reads queued: start a cycle now
+  std::atomic<bool> scan_pending_{false};
+  std::vector<RegisterRead> read_queue_;
+  ScanRequest scan_request_{};
+  std::vector<RegisterRead> read_ready_;
+  CallbackManager<void(RegisterRead)> register_read_callback_;
+  // Acquisition side
+  std::vector<RegisterRead> cycle_reads_;  // Taken from the queue when a cycle starts, sent in STATE_READS
+  ScanRequest scan_{};
+  uint16_t scan_next_{0};  // Value of the swept byte for the next read, past scan_.last when done
+  uint32_t scan_last_time_{0};
+  uint8_t scan_cycle_reads_{0};
+  uint16_t scan_sent_{0};
+  uint16_t scan_answered_{0};
+  void apply_scan_request_();
+  bool scan_due_(uint32_t now) const;
+  RegisterRead next_scan_read_(uint32_t now);
+  void send_read_(RegisterRead &&read);
+  void finish_read_(RegisterRead &&read);
+  void deliver_reads_();
+
+  // Cell voltages, pack voltage and temperature over time, recorded from published snapshots
+  uint16_t history_samples_[History::TIER_COUNT]{0};
+#ifdef USE_XGT_BATTERY_HISTORY
+  History history_;
+  std::mutex history_lock_;  // Recorded from loop(), read by the web server task
+  // This pack's own history option: the define is set for every pack once one of them has history
+  bool history_enabled_() const {
+    return this->history_samples_[0] > 0 || this->history_samples_[1] > 0 || this->history_samples_[2] > 0;
+  }
+  void record_history_(const Snapshot &snapshot);
+#endif
+
+  // Last transactions as raw frames, recorded when compiled with trace: ring
+  FrameTrace trace_;
+  uint8_t trace_size_{16};
+
+  // A value counts as fresh while its last good read is within the register's poll period plus
+  // max_value_age_, stale values are published as NaN (unavailable). 0 keeps publishing the last value.
+  uint32_t max_value_age_{0};
 
   // Protocol methods
-  bool check_crc(uint8_t *rx_buf, uint8_t length);
-  int8_t send_battery(uint8_t *buf, const uint8_t *command, uint8_t cmd_length, uint8_t *rx_length);
-  void publish_sensors();
+  void start_transaction(const uint8_t *command, uint8_t cmd_length, bool expect_response, uint8_t reg,
+                         TransactionCallback &&callback);
+  void run_transaction();
+  void send_command_();
+  void drain_rx_();
+  void receive_byte_(uint8_t byte, uint32_t now);
+  bool frame_complete_(uint32_t now) const;
+  void finish_transaction_();
+  uint32_t tx_time_ms_(uint8_t length) const;
+  uint32_t first_byte_timeout_(bool is_long_command) const;
+  uint32_t command_gap_(uint32_t configured_ms) const;
+  void acquire_(uint32_t now);
+  void take_snapshot_(uint32_t now);
+  void publish_snapshot_(const Snapshot &snapshot);
+  void publish_timing_(const Snapshot &snapshot);
+  void write_trace_(bool binary);
+  void count_health_(HealthMetric metric);
+  uint32_t value_lifetime_(uint8_t reg) const;
+  bool is_fresh_(const Snapshot &snapshot, uint8_t reg, uint32_t now) const;
+  bool is_cell_fresh_(const Snapshot &snapshot, uint8_t cell, uint32_t now) const;
+  void record_latency_(uint32_t latency_ms);
+  void record_failure_();
+  void publish_health_(const Snapshot &snapshot);
+  void set_phase_(TransactionPhase phase, uint32_t now, uint32_t duration);
+  void next_state_(DataState state);
+  uint32_t cycle_interval_() const;
+  bool acquire_bus_(uint32_t now);
+  void release_bus_();
+  void start_cycle_(uint32_t now);
+  void finish_cycle_(uint32_t now);
+  void compute_needed_registers_();
+  void poll_step_(const PollStep &step);
+  void log_poll_events_(uint16_t events);
+  static float cell_voltage_(uint16_t raw) { return raw * REGISTERS[REG_CELL_VOLTAGES].scale; }
+  void publish_state_(sensor::Sensor *sensor, float value);
+  void publish_sensors(const Snapshot &snapshot);
   void process_current_state();
 };
 
+class CaptureTrigger : public Trigger<std::vector<CaptureSample>> {
+ public:
+  explicit CaptureTrigger(XGTBattery *parent) {
+    parent->add_on_capture_callback([this](std::vector<CaptureSample> samples) { this->trigger(samples); });
+  }
+};
+
+template<typename... Ts> class StartCaptureAction : public Action<Ts...>, public Parented<XGTBattery> {
+ public:
+  TEMPLATABLE_VALUE(uint32_t, duration)
+  void add_register(Register reg) { this->registers_ |= 1 << reg; }
+  void set_cell(uint8_t cell) { this->cell_ = cell; }
+  void set_batch_size(uint8_t batch_size) { this->batch_size_ = batch_size; }
+  void play(Ts... x) override {
+    this->parent_->start_capture(this->registers_, this->cell_, this->duration_.value(x...), this->batch_size_);
+  }
+
+ protected:
+  uint16_t registers_{0};
+  uint8_t cell_{0};
+  uint8_t batch_size_{10};
+};
+
+template<typename... Ts> class StopCaptureAction : public Action<Ts...>, public Parented<XGTBattery> {
+ public:
+  void play(Ts... x) override { this->parent_->start_capture(0, 0, 0, 0); }
+};
+
+class RegisterReadTrigger : public Trigger<RegisterRead> {
+ public:
+  explicit RegisterReadTrigger(XGTBattery *parent) {
+    parent->add_on_register_read_callback([this](RegisterRead read) { this->trigger(read); });
+  }
+};
+
+template<typename... Ts> class ReadRegisterAction : public Action<Ts...>, public Parented<XGTBattery> {
+ public:
+  TEMPLATABLE_VALUE(std::string, request)
+  void set_long_frame_type(uint8_t type) {
+    this->long_frame_ = true;
+    this->type_ = type;
+  }
+  void play(Ts... x) override {
+    this->parent_->read_register(this->request_.value(x...), this->long_frame_, this->type_);
+  }
+
+ protected:
+  bool long_frame_{false};
+  uint8_t type_{0};
+};
+
+template<typename... Ts> class ScanRegistersAction : public Action<Ts...>, public Parented<XGTBattery> {
+ public:
+  TEMPLATABLE_VALUE(std::string, address)
+  TEMPLATABLE_VALUE(uint32_t, interval)
+  void set_range(uint8_t index, uint8_t first, uint8_t last, uint8_t step) {
+    this->index_ = index;
+    this->first_ = first;
+    this->last_ = last;
+    this->step_ = step;
+  }
+  void play(Ts... x) override {
+    this->parent_->scan_registers(this->address_.value(x...), this->index_, this->first_, this->last_, this->step_,
+                                  this->interval_.value(x...));
+  }
+
+ protected:
+  uint8_t index_{2};
+  uint8_t first_{0};
+  uint8_t last_{255};
+  uint8_t step_{1};
+};
+
+template<typename... Ts> class StopScanAction : public Action<Ts...>, public Parented<XGTBattery> {
+ public:
+  void play(Ts... x) override { this->parent_->scan_registers("", 0, 0, 0, 0, 0); }
+};
+
+template<typename... Ts> class DumpTraceAction : public Action<Ts...>, public Parented<XGTBattery> {
+ public:
+  void set_binary(bool binary) { this->binary_ = binary; }
+  void play(Ts... x) override { this->parent_->dump_trace(this->binary_); }
+
+ protected:
+  bool binary_{false};
+};
+
 }  // namespace xgt_battery
 }  // namespace esphome 
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+// Bus arbitration for several packs on one UART. The XGT protocol has no addressing, so each pack sits
+// behind its own select line and only one may be selected at a time. A pack owns the bus for a whole
+// cycle (wake + registers): switching mid-cycle would cost another wake settle per transaction.
+// Waiting packs are granted in arrival order, so every pack gets a turn before any pack gets a second.
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace esphome {
+namespace xgt_battery {
+
+class XGTBus {
+ public:
+  // True if owner holds the bus now, otherwise queues it (once) and returns false. Call again until granted.
+  bool acquire(const void *owner) {
+    std::lock_guard<std::mutex> guard(this->lock_);
+    if (this->owner_ == owner) {
+      return true;
+    }
+    if (this->owner_ == nullptr && (this->waiting_.empty() || this->waiting_.front() == owner)) {
+      if (!this->waiting_.empty()) {
+        this->waiting_.erase(this->waiting_.begin());
+      }
+      this->owner_ = owner;
+      return true;
+    }
+    for (const void *waiting : this->waiting_) {
+      if (waiting == owner) {
+        return false;
+      }
+    }
+    this->waiting_.push_back(owner);
+    return false;
+  }
+
+  void release(const void *owner) {
+    std::lock_guard<std::mutex> guard(this->lock_);
+    if (this->owner_ == owner) {
+      this->owner_ = nullptr;
+    }
+  }
+
+  void add_member() { this->members_++; }
+  uint8_t members() const { return this->members_; }
+  uint8_t waiting() const { return this->waiting_.size(); }
+
+ protected:
+  std::mutex lock_;  // Packs with a polling task arbitrate from different tasks
+  const void *owner_{nullptr};
+  std::vector<const void *> waiting_;  // FIFO, at most one entry per pack
+  uint8_t members_{0};
+};
+
+}  // namespace xgt_battery
+}  // namespace esphome
@@ -0,0 +1,226 @@
+#pragma once
+
+// Fixed-memory history of cell voltages, pack voltage and temperature at three resolutions: every cycle,
+// 1 minute and 15 minute averages. Samples are kept in blocks: the first sample of a block in full, the
+// others as 8-bit differences to the sample before, about half the size of plain 16-bit values. A block
+// is closed early when a difference does not fit or the set of valid channels changes, so the encoding
+// is lossless. Written by the polling cycle only; readers take a copy of a tier (copy_from) and decode that.
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace esphome {
+namespace xgt_battery {
+
+// Cells 1..10 and pack voltage in mV, temperature as the raw register value (0.1 K)
+static const uint8_t HISTORY_CELLS = 10;
+static const uint8_t HISTORY_PACK_VOLTAGE = 10;
+static const uint8_t HISTORY_TEMPERATURE = 11;
+static const uint8_t HISTORY_CHANNELS = 12;
+static const uint8_t HISTORY_BLOCK_SAMPLES = 16;
+
+struct HistorySample {
+  uint32_t time_ms;
+  uint16_t valid;  // (1 << channel) bits
+  uint16_t values[HISTORY_CHANNELS];
+};
+
+struct HistoryBlock {
+  uint32_t start_ms;
+  uint16_t valid;
+  uint16_t base[HISTORY_CHANNELS];
+  uint8_t count;
+  uint16_t offset_s[HISTORY_BLOCK_SAMPLES - 1];  // After start_ms
+  int8_t deltas[HISTORY_BLOCK_SAMPLES - 1][HISTORY_CHANNELS];
+};
+
+class HistoryTier {
+ public:
+  // Room for samples samples while differences fit (blocks closed early hold fewer). period_ms = 0 stores
+  // every sample, otherwise one average per period. samples = 0 stores nothing but still averages.
+  void init(uint16_t samples, uint32_t period_ms) {
+    this->capacity_ = samples > 0 ? (samples + HISTORY_BLOCK_SAMPLES - 1) / HISTORY_BLOCK_SAMPLES + 1 : 0;
+    this->blocks_.reset(samples > 0 ? new HistoryBlock[this->capacity_] : nullptr);
+    this->period_ms_ = period_ms;
+    this->head_ = 0;
+    this->count_ = 0;
+    this->window_samples_ = 0;
+  }
+
+  bool enabled() const { return this->blocks_ != nullptr; }
+  uint32_t period_ms() const { return this->period_ms_; }
+  size_t memory_size() const { return this->capacity_ * sizeof(HistoryBlock); }
+
+  // Takes over other's samples in their encoded form, a quick copy to make while other is locked
+  void copy_from(const HistoryTier &other) {
+    if (this->capacity_ != other.capacity_) {
+      this->blocks_.reset(other.capacity_ > 0 ? new HistoryBlock[other.capacity_] : nullptr);
+      this->capacity_ = other.capacity_;
+    }
+    if (this->capacity_ > 0) {
+      memcpy(this->blocks_.get(), other.blocks_.get(), this->capacity_ * sizeof(HistoryBlock));
+    }
+    this->head_ = other.head_;
+    this->count_ = other.count_;
+    memcpy(this->last_, other.last_, sizeof(this->last_));
+    this->period_ms_ = other.period_ms_;
+  }
+
+  // Returns true and fills *average when a period closed, for feeding the next coarser tier
+  bool add(const HistorySample &sample, HistorySample *average = nullptr) {
+    if (this->period_ms_ == 0) {
+      if (this->enabled()) {
+        this->store_(sample);
+      }
+      return false;
+    }
+
+    bool closed = false;
+    if (this->window_samples_ > 0 && sample.time_ms - this->window_start_ >= this->period_ms_) {
+      HistorySample result{this->window_start_, 0, {0}};
+      for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+        if (this->window_counts_[ch] > 0) {
+          result.valid |= 1 << ch;
+          result.values[ch] = (this->window_sums_[ch] + this->window_counts_[ch] / 2) / this->window_counts_[ch];
+        }
+      }
+      if (this->enabled()) {
+        this->store_(result);
+      }
+      if (average != nullptr) {
+        *average = result;
+      }
+      closed = true;
+      this->window_samples_ = 0;
+    }
+    if (this->window_samples_ == 0) {
+      this->window_start_ = sample.time_ms - sample.time_ms % this->period_ms_;
+      memset(this->window_sums_, 0, sizeof(this->window_sums_));
+      memset(this->window_counts_, 0, sizeof(this->window_counts_));
+    }
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+      if (sample.valid & (1 << ch)) {
+        this->window_sums_[ch] += sample.values[ch];
+        this->window_counts_[ch]++;
+      }
+    }
+    this->window_samples_++;
+    return closed;
+  }
+
+  // Calls f(const HistorySample &) for every stored sample, oldest first
+  template<typename F> void for_each(F f) const {
+    for (uint8_t i = 0; i < this->count_; i++) {
+      const HistoryBlock &block = this->blocks_[(this->head_ + this->capacity_ - this->count_ + i) % this->capacity_];
+      HistorySample sample{block.start_ms, block.valid, {0}};
+      memcpy(sample.values, block.base, sizeof(sample.values));
+      f(sample);
+      for (uint8_t n = 0; n + 1 < block.count; n++) {
+        sample.time_ms = block.start_ms + block.offset_s[n] * 1000;
+        for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+          sample.values[ch] += block.deltas[n][ch];
+        }
+        f(sample);
+      }
+    }
+  }
+
+  uint16_t size() const {
+    uint16_t samples = 0;
+    for (uint8_t i = 0; i < this->count_; i++) {
+      samples += this->blocks_[(this->head_ + this->capacity_ - this->count_ + i) % this->capacity_].count;
+    }
+    return samples;
+  }
+
+ protected:
+  void store_(const HistorySample &sample) {
+    if (this->count_ > 0 && this->append_(sample)) {
+      return;
+    }
+    // New block, dropping the oldest one when the ring is full
+    HistoryBlock &block = this->blocks_[this->head_];
+    block.start_ms = sample.time_ms;
+    block.valid = sample.valid;
+    block.count = 1;
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+      block.base[ch] = sample.valid & (1 << ch) ? sample.values[ch] : 0;
+    }
+    memcpy(this->last_, block.base, sizeof(this->last_));
+    this->head_ = (this->head_ + 1) % this->capacity_;
+    if (this->count_ < this->capacity_) {
+      this->count_++;
+    }
+  }
+
+  bool append_(const HistorySample &sample) {
+    HistoryBlock &block = this->blocks_[(this->head_ + this->capacity_ - 1) % this->capacity_];
+    uint32_t offset_s = (sample.time_ms - block.start_ms) / 1000;
+    if (block.count >= HISTORY_BLOCK_SAMPLES || block.valid != sample.valid || offset_s > UINT16_MAX) {
+      return false;
+    }
+    int8_t deltas[HISTORY_CHANNELS] = {0};
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+      if (!(sample.valid & (1 << ch))) {
+        continue;
+      }
+      int32_t delta = static_cast<int32_t>(sample.values[ch]) - this->last_[ch];
+      if (delta < INT8_MIN || delta > INT8_MAX) {
+        return false;
+      }
+      deltas[ch] = delta;
+    }
+    block.offset_s[block.count - 1] = offset_s;
+    memcpy(block.deltas[block.count - 1], deltas, sizeof(deltas));
+    block.count++;
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+      this->last_[ch] += deltas[ch];
+    }
+    return true;
+  }
+
+  std::unique_ptr<HistoryBlock[]> blocks_;
+  uint8_t capacity_{0};  // Blocks, one more than needed so a partly filled oldest block does not cut the window
+  uint8_t head_{0};      // Next block to start
+  uint8_t count_{0};
+  uint16_t last_[HISTORY_CHANNELS]{0};  // Newest stored values, what the next delta is taken against
+  uint32_t period_ms_{0};
+
+  // Averaging window of a downsampled tier
+  uint32_t window_start_{0};
+  uint16_t window_samples_{0};
+  uint32_t window_sums_[HISTORY_CHANNELS]{0};
+  uint16_t window_counts_[HISTORY_CHANNELS]{0};
+};
+
+// The three tiers together: every cycle, 1 minute and 15 minute averages
+class History {
+ public:
+  static const uint8_t TIER_COUNT = 3;
+
+  void init(uint16_t raw_samples, uint16_t minute_samples, uint16_t quarter_samples) {
+    this->tiers_[0].init(raw_samples, 0);
+    this->tiers_[1].init(minute_samples, 60 * 1000);
+    this->tiers_[2].init(quarter_samples, 15 * 60 * 1000);
+  }
+
+  void add(const HistorySample &sample) {
+    this->tiers_[0].add(sample);
+    HistorySample minute{};
+    if (this->tiers_[1].add(sample, &minute)) {
+      this->tiers_[2].add(minute);
+    }
+  }
+
+  const HistoryTier &tier(uint8_t index) const { return this->tiers_[index]; }
+  size_t memory_size() const {
+    return this->tiers_[0].memory_size() + this->tiers_[1].memory_size() + this->tiers_[2].memory_size();
+  }
+
+ protected:
+  HistoryTier tiers_[TIER_COUNT];
+};
+
+}  // namespace xgt_battery
+}  // namespace esphome
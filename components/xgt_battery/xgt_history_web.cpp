@@ -0,0 +1,65 @@
+#include "xgt_history_web.h"
+#ifdef USE_XGT_BATTERY_HISTORY
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace xgt_battery {
+
+static const char *const TAG = "xgt_battery.history";
+
+static const char *const TIER_NAMES[History::TIER_COUNT] = {"raw", "minute", "quarter_hour"};
+
+void XGTHistoryHandler::handleRequest(AsyncWebServerRequest *request) {
+  uint8_t tier = 0;
+  if (request->hasParam("tier")) {
+    std::string name = request->getParam("tier")->value().c_str();
+    while (tier < History::TIER_COUNT && name != TIER_NAMES[tier]) {
+      tier++;
+    }
+    if (tier == History::TIER_COUNT) {
+      request->send(400, "text/plain", "tier must be raw, minute or quarter_hour");
+      return;
+    }
+  }
+
+  // Copied first, so the polling cycle is not held up while the response is written out
+  HistoryTier history;
+  this->battery_->read_history(tier, [&](const HistoryTier &locked) { history.copy_from(locked); });
+
+  // Rows are [age_s, cell_1_mv .. cell_10_mv, pack_voltage_mv, temperature_c], oldest first, null where the
+  // value was unavailable. Ages instead of timestamps: the device has no wall clock of its own.
+  AsyncResponseStream *stream = request->beginResponseStream("application/json");
+  uint32_t now = millis();
+  stream->printf("{\"tier\":\"%s\",\"period_s\":%u,\"columns\":[\"age_s\"", TIER_NAMES[tier],
+                 static_cast<unsigned>(history.period_ms() / 1000));
+  for (uint8_t cell = 1; cell <= HISTORY_CELLS; cell++) {
+    stream->printf(",\"cell_%u_mv\"", cell);
+  }
+  stream->print(",\"pack_voltage_mv\",\"temperature_c\"],\"samples\":[");
+  bool first = true;
+  history.for_each([&](const HistorySample &sample) {
+    stream->printf("%s[%u", first ? "" : ",", static_cast<unsigned>((now - sample.time_ms) / 1000));
+    first = false;
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+      if (!(sample.valid & (1 << ch))) {
+        stream->print(",null");
+      } else if (ch == HISTORY_TEMPERATURE) {
+        stream->printf(",%.1f", sample.values[ch] * 0.1f - 273.1f);  // Deci-Kelvin, as the temperature sensor
+      } else {
+        stream->printf(",%u", sample.values[ch]);
+      }
+    }
+    stream->print("]");
+  });
+  stream->print("]}");
+  request->send(stream);
+}
+
+void XGTHistoryHandler::dump_config() { ESP_LOGCONFIG(TAG, "XGT Battery History: %s", this->path_.c_str()); }
+
+}  // namespace xgt_battery
+}  // namespace esphome
+
+#endif  // USE_XGT_BATTERY_HISTORY
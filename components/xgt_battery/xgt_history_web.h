@@ -0,0 +1,42 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#ifdef USE_XGT_BATTERY_HISTORY
+
+#include "esphome/core/component.h"
+#include "esphome/components/web_server_base/web_server_base.h"
+#include "xgt_battery.h"
+#include <string>
+
+namespace esphome {
+namespace xgt_battery {
+
+// Serves a pack's history as one JSON document, GET /xgt_battery/<id>/history?tier=raw|minute|quarter_hour,
+// so a dashboard pulls hours of cell data in one request instead of following every sensor update
+class XGTHistoryHandler : public AsyncWebHandler, public Component {
+ public:
+  XGTHistoryHandler(web_server_base::WebServerBase *base, XGTBattery *battery, const std::string &name)
+      : base_(base), battery_(battery), path_("/xgt_battery/" + name + "/history") {}
+
+  bool canHandle(AsyncWebServerRequest *request) override {
+    return request->method() == HTTP_GET && std::string(request->url().c_str()) == this->path_;
+  }
+  void handleRequest(AsyncWebServerRequest *request) override;
+
+  void setup() override {
+    this->base_->init();
+    this->base_->add_handler(this);
+  }
+  void dump_config() override;
+  float get_setup_priority() const override { return setup_priority::WIFI - 1.0f; }
+
+ protected:
+  web_server_base::WebServerBase *base_;
+  XGTBattery *battery_;
+  std::string path_;
+};
+
+}  // namespace xgt_battery
+}  // namespace esphome
+
+#endif  // USE_XGT_BATTERY_HISTORY
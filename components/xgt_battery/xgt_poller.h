@@ -0,0 +1,520 @@
+#pragma once
+
+// Acquisition state of one pack, without any I/O: which command a polling cycle sends next (short reads in
+// table order, or batched long frames once the pack is known to answer them) and what the answers mean
+// for the cached values, the cell count and pack presence. XGTBattery sends the steps over the UART and
+// xgt_harness over the simulator, so both run the same sequence. Nothing is logged here; calls return
+// PollEvent bits for the caller to report.
+
+#include "xgt_registers.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace xgt_battery {
+
+// start_capture() cell: the lowest cell of the last reading
+static const uint8_t CAPTURE_WEAKEST_CELL = 0xFF;
+
+enum PollEvent : uint16_t {
+  POLL_EVENT_RETRY = 1 << 0,              // strict_crc: garbled answer, the same step goes out again
+  POLL_EVENT_CELLS_DETECTED = 1 << 1,     // cell_count() is known now
+  POLL_EVENT_CELLS_NONE = 1 << 2,         // Not even cell 1 answered, detection runs again next cycle
+  POLL_EVENT_CELLS_MISMATCH = 1 << 3,     // detect_count() cells do not add up to detect_pack_mv(), same
+  POLL_EVENT_BATCH_SUPPORTED = 1 << 4,
+  POLL_EVENT_BATCH_UNSUPPORTED = 1 << 5,  // Short commands until the pack is re-inserted
+  POLL_EVENT_BATCH_FAILED = 1 << 6,       // Short commands for the rest of this cycle
+  POLL_EVENT_PACK_DETECTED = 1 << 7,
+  POLL_EVENT_PACK_REMOVED = 1 << 8,
+  POLL_EVENT_WEAKEST_CELL = 1 << 9,       // A weakest-cell capture resolved to capture_cell()
+};
+
+// One command of a cycle
+struct PollStep {
+  uint8_t reg;      // Register read, REG_COUNT for a batch
+  uint8_t cell;     // 1..MAX_CELLS for REG_CELL_VOLTAGES
+  uint16_t gap_ms;  // Configured bus idle time before the command
+  uint8_t length;
+  uint8_t command[MAX_FRAME_LENGTH];  // Wire order
+};
+
+class PackPoller {
+ public:
+  // Registers ((1 << Register) bits) and cells ((1 << (cell - 1)) bits) that feed a sensor or derived value
+  void set_needed(uint16_t registers, uint16_t cells) {
+    this->needed_registers_ = registers;
+    this->needed_cells_ = cells;
+  }
+  uint16_t needed_registers() const { return this->needed_registers_; }
+  uint16_t needed_cells() const { return this->needed_cells_; }
+
+  // Per-register override of the table's poll class
+  void set_poll_class(uint8_t reg, PollClass poll_class) {
+    if (reg < REG_COUNT && poll_class < POLL_CLASS_COUNT) {
+      this->poll_classes_[reg] = poll_class;
+    }
+  }
+  PollClass poll_class(uint8_t reg) const {
+    return this->poll_classes_[reg] < POLL_CLASS_COUNT ? this->poll_classes_[reg] : REGISTERS[reg].poll_class;
+  }
+  void set_class_interval(PollClass poll_class, uint32_t interval_ms) {
+    this->class_intervals_[poll_class] = interval_ms;
+  }
+  uint32_t class_interval(PollClass poll_class) const { return this->class_intervals_[poll_class]; }
+
+  // With strict_crc only CRC-valid frames update the values, and garbled answers are re-polled up to
+  // retry_budget times per cycle
+  void set_strict_crc(bool strict_crc) { this->strict_crc_ = strict_crc; }
+  bool strict_crc() const { return this->strict_crc_; }
+  void set_retry_budget(uint8_t retry_budget) { this->retry_budget_ = retry_budget; }
+  uint8_t retry_budget() const { return this->retry_budget_; }
+  void set_batch_reads(bool batch_reads) { this->batch_reads_ = batch_reads; }
+  bool batch_reads() const { return this->batch_reads_; }
+  // A cycle with nothing due sends no command and says nothing about the pack. With a presence probe it
+  // reads battery_charge instead, so pack_present() is current after every cycle.
+  void set_presence_probe(bool presence_probe) { this->presence_probe_ = presence_probe; }
+  bool presence_probe() const { return this->presence_probe_; }
+
+  // Live capture: only registers ((1 << Register) bits) and cell (0 = none, 1..MAX_CELLS or
+  // CAPTURE_WEAKEST_CELL) are polled until end_capture(), and poll classes stay untouched
+  void start_capture(uint16_t registers, uint8_t cell) {
+    this->capture_registers_ = registers;
+    if (cell != 0) {
+      this->capture_registers_ |= 1 << REG_CELL_VOLTAGES;
+    }
+    this->capture_weakest_ = cell == CAPTURE_WEAKEST_CELL;
+    this->capture_cell_ = this->capture_weakest_ ? 0 : cell;
+    this->capture_active_ = true;
+  }
+  void end_capture() { this->capture_active_ = false; }
+  bool capture_active() const { return this->capture_active_; }
+  uint16_t capture_registers() const { return this->capture_registers_; }
+  uint8_t capture_cell() const { return this->capture_cell_; }  // 0 while a weakest cell is unresolved
+
+  // Starts a cycle at now; woke: the wake byte went out before it. The fast class always runs, slow and
+  // static classes when their interval has passed or they have not been read since the pack was detected.
+  uint16_t begin_cycle(uint32_t now, bool woke) {
+    uint16_t events = 0;
+    this->cycle_classes_ = 1 << POLL_FAST;
+    for (uint8_t i = 0; i < POLL_CLASS_COUNT; i++) {
+      if (!this->class_polled_[i] || now - this->class_last_poll_[i] >= this->class_intervals_[i]) {
+        this->cycle_classes_ |= 1 << i;
+      }
+    }
+    if (this->capture_active_ && this->capture_weakest_ && this->capture_cell_ == 0 && this->cell_count_ > 0) {
+      this->capture_cell_ = 1;
+      for (uint8_t cell = 2; cell <= this->cell_count_; cell++) {
+        if (this->cell_raw_[cell - 1] < this->cell_raw_[this->capture_cell_ - 1]) {
+          this->capture_cell_ = cell;
+        }
+      }
+      events |= POLL_EVENT_WEAKEST_CELL;
+    }
+    this->cycle_woke_ = woke;
+    this->cycle_responses_ = 0;
+    this->cycle_good_ = 0;
+    this->cycle_transactions_ = 0;
+    this->cycle_commands_ = 0;
+    this->cycle_absent_ = false;
+    this->retries_left_ = this->retry_budget_;
+    this->cycle_batch_ = this->batch_reads_ && this->batch_support_ != BATCH_UNSUPPORTED;
+    this->current_register_ = 0;
+    this->current_cell_ = this->next_needed_cell_(1);
+    this->step_ready_ = false;
+    return events;
+  }
+
+  // Next command of the running cycle, nullptr once the cycle is done. Stays the same step until handle()
+  // takes its answer, so it can be asked for repeatedly while the caller waits out the gap.
+  const PollStep *next() {
+    if (this->step_ready_) {
+      return &this->step_;
+    }
+    // The first command doubled as the presence probe; without a pack the rest would only time out
+    if (this->cycle_absent_) {
+      return nullptr;
+    }
+    // Skip registers that are not due this cycle without spending bus time
+    while (this->current_register_ < REG_COUNT &&
+           (!this->is_due_(this->current_register_) ||
+            (this->current_register_ == REG_CELL_VOLTAGES && this->current_cell_ > this->last_cell()))) {
+      this->current_register_++;
+    }
+    if (this->current_register_ >= REG_COUNT) {
+      if (!this->presence_probe_ || this->capture_active_ || this->cycle_commands_ > 0) {
+        return nullptr;
+      }
+      this->current_register_ = REG_CHARGE;  // The presence probe, handled like any read of it
+    }
+
+    PollStep &step = this->step_;
+    step.gap_ms = REGISTERS[this->current_register_].gap_ms;
+    step.cell = 0;
+    // A single remaining register is cheaper as a short command
+    if (this->cycle_batch_ && this->collect_batch_() > 1) {
+      uint8_t commands[BATCH_MAX_REGISTERS][SHORT_FRAME_LENGTH];
+      const uint8_t *command_ptrs[BATCH_MAX_REGISTERS];
+      for (uint8_t i = 0; i < this->batch_count_; i++) {
+        this->item_command_(this->batch_items_[i], commands[i]);
+        command_ptrs[i] = commands[i];
+      }
+      step.reg = REG_COUNT;
+      step.length = build_batch_command(command_ptrs, this->batch_count_, step.command);
+    } else {
+      step.reg = this->current_register_;
+      step.cell = this->current_register_ == REG_CELL_VOLTAGES ? this->current_cell_ : 0;
+      step.length = SHORT_FRAME_LENGTH;
+      this->item_command_({step.reg, step.cell}, step.command);
+    }
+    this->step_ready_ = true;
+    return &step;
+  }
+  // The step next() returned and handle() has not taken yet, if any
+  const PollStep *pending() const { return this->step_ready_ ? &this->step_ : nullptr; }
+
+  // Answer to the pending step: result 0 = ok, 1 = short/no response, -1 = CRC error, and the length bytes
+  // received, bit order converted
+  uint16_t handle(int8_t result, const uint8_t *buf, uint8_t length, uint32_t now) {
+    this->count_response(length);
+    this->cycle_commands_++;
+    if (this->step_.reg == REG_COUNT) {
+      // Not a presence probe: a pack without batch support is silent too, the short command after it decides
+      this->step_ready_ = false;
+      return this->handle_batch_(result, buf, length, now);
+    }
+    // Not a byte on the first short command of the cycle, after all attempts, and nothing before: no pack
+    bool first = this->cycle_transactions_++ == 0;
+    if (first && length == 0 && this->cycle_responses_ == 0) {
+      this->cycle_absent_ = true;
+    }
+    if (this->retry_in_cycle_(result, length)) {
+      return POLL_EVENT_RETRY;  // step_ready_ stays set: the same register or cell again
+    }
+    this->step_ready_ = false;
+    if (this->step_.reg == REG_CELL_VOLTAGES) {
+      return this->handle_cell_(result, buf, length, now);
+    }
+    this->handle_register_(this->step_.reg, result, buf, length, now);
+    return 0;
+  }
+  // A transaction outside the table in the running cycle; any frame shows the pack is there
+  void count_response(uint8_t length) {
+    if (length >= SHORT_FRAME_LENGTH) {
+      this->cycle_responses_++;
+    }
+  }
+
+  // Ends the running cycle. A frame means the pack is there; no frame to a command after the wake byte
+  // means it is not. A capture row sent without the wake byte may only have found the pack asleep, and a
+  // cycle with nothing due asked nothing: both leave the presence as it was.
+  uint16_t end_cycle(uint32_t now) {
+    uint16_t events = 0;
+    bool present = this->cycle_responses_ > 0;
+    bool conclusive = present || (this->cycle_woke_ && this->cycle_commands_ > 0);
+    if (conclusive && present != this->pack_present_) {
+      events |= present ? POLL_EVENT_PACK_DETECTED : POLL_EVENT_PACK_REMOVED;
+      this->pack_present_ = present;
+    }
+    if (present) {
+      this->absent_cycles_ = 0;
+    } else if (conclusive && this->absent_cycles_ < UINT8_MAX) {
+      this->absent_cycles_++;
+    }
+
+    if (!present && conclusive) {
+      // Nothing answered: pack removed or not inserted. Re-read everything once it is back, and keep the
+      // previous pack's values from counting as valid for the next one.
+      for (auto &polled : this->class_polled_) {
+        polled = false;
+      }
+      this->good_registers_ = 0;
+      this->decoded_registers_ = 0;
+      this->good_cells_ = 0;
+      memset(this->last_good_, 0, sizeof(this->last_good_));
+      memset(this->cell_last_good_, 0, sizeof(this->cell_last_good_));
+      this->cell_count_ = 0;
+      this->batch_support_ = BATCH_UNKNOWN;
+    } else if (present && !this->capture_active_) {
+      for (uint8_t i = 0; i < POLL_CLASS_COUNT; i++) {
+        if (this->cycle_classes_ & (1 << i)) {
+          this->class_polled_[i] = true;
+          this->class_last_poll_[i] = now;
+        }
+      }
+    }
+    return events;
+  }
+
+  bool pack_present() const { return this->pack_present_; }
+  uint8_t absent_cycles() const { return this->absent_cycles_; }
+  bool cycle_woke() const { return this->cycle_woke_; }
+  bool cycle_absent() const { return this->cycle_absent_; }  // The first command found no pack
+  uint8_t cycle_responses() const { return this->cycle_responses_; }  // Frames received in the running cycle
+  uint8_t retries_left() const { return this->retries_left_; }
+
+  // Number of series cells in the inserted pack, 0 until detected. While unknown, every cell is polled
+  // and the first cell without a valid answer marks the end of the pack.
+  uint8_t cell_count() const { return this->cell_count_; }
+  uint8_t last_cell() const { return this->cell_count_ != 0 ? this->cell_count_ : MAX_CELLS; }
+  // The last detection attempt: cells found, their sum and the pack voltage in mV (0 = not read that cycle)
+  uint8_t detect_count() const { return this->detect_count_; }
+  uint32_t detect_cells_mv() const { return this->detect_cells_mv_; }
+  uint16_t detect_pack_mv() const { return this->detect_pack_mv_; }
+
+  // Raw values as decoded from the responses, scaled at publish time. A register counts as decoded once
+  // any accepted frame carried it, as good once a CRC-valid one did; last_good is when that last happened.
+  const uint16_t *raw_values() const { return this->raw_values_; }
+  uint16_t decoded_registers() const { return this->decoded_registers_; }
+  const uint16_t *cell_values() const { return this->cell_raw_; }  // mV, cell 1 first
+  uint16_t good_registers() const { return this->good_registers_; }
+  uint16_t good_cells() const { return this->good_cells_; }
+  uint32_t last_good(uint8_t reg) const { return this->last_good_[reg]; }
+  uint32_t cell_last_good(uint8_t cell) const { return this->cell_last_good_[cell - 1]; }
+
+ protected:
+  enum BatchSupport : uint8_t {
+    BATCH_UNKNOWN,
+    BATCH_SUPPORTED,
+    BATCH_UNSUPPORTED,
+  };
+  struct BatchItem {
+    uint8_t reg;
+    uint8_t cell;  // 1..MAX_CELLS for REG_CELL_VOLTAGES
+  };
+
+  bool is_due_(uint8_t reg) const {
+    // The cell count is checked against the pack voltage, so it is read with the cells until the count is known
+    if (reg == REG_PACK_VOLTAGE && this->cell_count_ == 0 && this->is_due_(REG_CELL_VOLTAGES)) {
+      return true;
+    }
+    if (this->capture_active_) {
+      return this->capture_registers_ & (1 << reg);
+    }
+    if (!(this->needed_registers_ & (1 << reg))) {
+      return false;
+    }
+    // Without a good read from this pack yet, a register stays due whatever its class: a static one that
+    // failed on detection would otherwise wait for static_interval
+    bool read = reg == REG_CELL_VOLTAGES ? this->cell_count_ > 0 : (this->good_registers_ & (1 << reg)) != 0;
+    return !read || (this->cycle_classes_ & (1 << this->poll_class(reg)));
+  }
+
+  uint8_t next_needed_cell_(uint8_t cell) const {
+    // Cells are numbered from 1; returns a cell past last_cell() once no needed cell is left.
+    // Detection needs the cells in sequence, so nothing is skipped until the count is known.
+    if (this->cell_count_ == 0) {
+      return cell;
+    }
+    uint16_t cells = this->needed_cells_;
+    if (this->capture_active_) {
+      cells = this->capture_cell_ > 0 ? 1 << (this->capture_cell_ - 1) : 0;
+    }
+    while (cell <= this->cell_count_ && !(cells & (1 << (cell - 1)))) {
+      cell++;
+    }
+    return cell;
+  }
+
+  static void item_command_(const BatchItem &item, uint8_t *command) {
+    if (item.reg == REG_CELL_VOLTAGES) {
+      build_cell_command(REGISTERS[REG_CELL_VOLTAGES].command, item.cell, command);
+    } else {
+      memcpy(command, REGISTERS[item.reg].command, SHORT_FRAME_LENGTH);
+    }
+  }
+
+  // Without strict_crc a frame with a bad checksum is still used, like the working implementation, but only
+  // when shaped like a short response: noise cut off by the receive timeout decodes to garbage
+  bool accept_frame_(int8_t result, const uint8_t *buf, uint8_t length) const {
+    return is_short_frame(buf, length) && (result == 0 || !this->strict_crc_);
+  }
+
+  bool retry_in_cycle_(int8_t result, uint8_t length) {
+    // Only garbled answers: a silent register was already retried by the transaction, and cells
+    // past the end of the pack never answer
+    if (!this->strict_crc_ || result == 0 || length == 0 || this->retries_left_ == 0) {
+      return false;
+    }
+    this->retries_left_--;
+    return true;
+  }
+
+  uint16_t detect_cell_count_(uint8_t count) {
+    this->detect_count_ = count;
+    this->detect_cells_mv_ = 0;
+    this->detect_pack_mv_ = (this->cycle_good_ & (1 << REG_PACK_VOLTAGE)) ? this->raw_values_[REG_PACK_VOLTAGE] : 0;
+    if (count == 0) {
+      return POLL_EVENT_CELLS_NONE;
+    }
+
+    // A single dropped answer would cut the count short: the detected cells must add up to the pack voltage
+    // read in the same cycle
+    for (uint8_t i = 0; i < count; i++) {
+      this->detect_cells_mv_ += this->cell_raw_[i];
+    }
+    uint32_t pack_mv = this->detect_pack_mv_;
+    if (pack_mv == 0 || this->detect_cells_mv_ * 10 < pack_mv * 9 || this->detect_cells_mv_ * 10 > pack_mv * 11) {
+      return POLL_EVENT_CELLS_MISMATCH;
+    }
+
+    this->cell_count_ = count;
+    for (uint8_t i = count; i < MAX_CELLS; i++) {
+      this->cell_raw_[i] = 0;
+    }
+    return POLL_EVENT_CELLS_DETECTED;
+  }
+
+  void handle_register_(uint8_t reg, int8_t result, const uint8_t *buf, uint8_t length, uint32_t now) {
+    if (this->accept_frame_(result, buf, length)) {
+      this->raw_values_[reg] = REGISTERS[reg].decode(buf);
+      this->decoded_registers_ |= 1 << reg;
+      if (result == 0) {
+        this->last_good_[reg] = now;
+        this->good_registers_ |= 1 << reg;
+        this->cycle_good_ |= 1 << reg;
+      }
+    }
+    this->current_register_ = reg + 1;
+  }
+
+  uint16_t handle_cell_(int8_t result, const uint8_t *buf, uint8_t length, uint32_t now) {
+    uint16_t raw = is_short_frame(buf, length) ? REGISTERS[REG_CELL_VOLTAGES].decode(buf) : 0;
+    uint8_t cell = this->current_cell_;
+    if (this->cell_count_ == 0 && (result != 0 || raw == 0)) {
+      // First cell without a valid answer: the pack ends at the previous one
+      this->current_register_ = REG_CELL_VOLTAGES + 1;
+      return this->detect_cell_count_(cell - 1);
+    }
+    if (this->accept_frame_(result, buf, length)) {
+      this->cell_raw_[cell - 1] = raw;
+      if (result == 0) {
+        this->cell_last_good_[cell - 1] = now;
+        this->good_cells_ |= 1 << (cell - 1);
+      }
+    }
+    this->current_cell_ = this->next_needed_cell_(cell + 1);
+    if (this->current_cell_ > this->last_cell()) {
+      this->current_register_ = REG_CELL_VOLTAGES + 1;
+      if (this->cell_count_ == 0) {
+        return this->detect_cell_count_(MAX_CELLS);
+      }
+    }
+    return 0;
+  }
+
+  uint8_t collect_batch_() {
+    // The registers and cells the short path would poll next, in the same order
+    uint8_t reg = this->current_register_;
+    uint8_t cell = this->current_cell_;
+    this->batch_count_ = 0;
+    while (this->batch_count_ < BATCH_MAX_REGISTERS && reg < REG_COUNT) {
+      if (!this->is_due_(reg) || (reg == REG_CELL_VOLTAGES && cell > this->last_cell())) {
+        reg++;
+        continue;
+      }
+      if (reg == REG_CELL_VOLTAGES) {
+        this->batch_items_[this->batch_count_++] = {reg, cell};
+        cell = this->next_needed_cell_(cell + 1);
+        continue;
+      }
+      this->batch_items_[this->batch_count_++] = {reg, 0};
+      reg++;
+    }
+    return this->batch_count_;
+  }
+
+  uint16_t handle_batch_(int8_t result, const uint8_t *buf, uint8_t length, uint32_t now) {
+    if (result != 0 || !is_batch_response(buf, length, this->batch_count_)) {
+      this->cycle_batch_ = false;  // Same position again, with short commands
+      // A CRC error may be line noise on a real answer; only silence or a foreign frame rules batching out
+      if (this->batch_support_ == BATCH_UNKNOWN && result != -1) {
+        this->batch_support_ = BATCH_UNSUPPORTED;
+        return POLL_EVENT_BATCH_UNSUPPORTED;
+      }
+      return POLL_EVENT_BATCH_FAILED;
+    }
+    uint16_t events = 0;
+    if (this->batch_support_ == BATCH_UNKNOWN) {
+      this->batch_support_ = BATCH_SUPPORTED;
+      events |= POLL_EVENT_BATCH_SUPPORTED;
+    }
+
+    for (uint8_t i = 0; i < this->batch_count_; i++) {
+      const BatchItem &item = this->batch_items_[i];
+      uint8_t command[SHORT_FRAME_LENGTH];
+      uint8_t response[SHORT_FRAME_LENGTH];
+      item_command_(item, command);
+      batch_short_response(buf, command, i, response);
+      if (item.reg == REG_CELL_VOLTAGES) {
+        // Cell detection may end the pack early; the remaining cells do not exist
+        if (this->current_register_ > REG_CELL_VOLTAGES) {
+          break;
+        }
+        this->current_register_ = REG_CELL_VOLTAGES;
+        this->current_cell_ = item.cell;
+        events |= this->handle_cell_(0, response, SHORT_FRAME_LENGTH, now);
+      } else {
+        this->handle_register_(item.reg, 0, response, SHORT_FRAME_LENGTH, now);
+      }
+    }
+    return events;
+  }
+
+  uint16_t needed_registers_{0};
+  uint16_t needed_cells_{0};
+  bool strict_crc_{false};
+  uint8_t retry_budget_{3};
+  bool batch_reads_{false};
+  bool presence_probe_{false};
+
+  // Tiered polling: the fast class runs every cycle, the others only when due
+  uint32_t class_intervals_[POLL_CLASS_COUNT]{3600000, 60000, 0};
+  uint32_t class_last_poll_[POLL_CLASS_COUNT]{0};
+  bool class_polled_[POLL_CLASS_COUNT]{false};
+  // Per-register override of the table's default poll class, POLL_CLASS_COUNT = use default
+  PollClass poll_classes_[REG_COUNT]{POLL_CLASS_COUNT, POLL_CLASS_COUNT, POLL_CLASS_COUNT, POLL_CLASS_COUNT,
+                                     POLL_CLASS_COUNT, POLL_CLASS_COUNT, POLL_CLASS_COUNT, POLL_CLASS_COUNT};
+
+  bool capture_active_{false};
+  bool capture_weakest_{false};
+  uint16_t capture_registers_{0};
+  uint8_t capture_cell_{0};
+
+  // Running cycle
+  uint8_t cycle_classes_{0};       // Bitmask of classes polled in the running cycle
+  bool cycle_woke_{false};         // The running cycle began with the wake byte
+  bool cycle_absent_{false};       // First command of the running cycle went unanswered
+  bool cycle_batch_{false};        // Cleared for the rest of a cycle after a failed batch
+  uint8_t cycle_transactions_{0};  // Short table commands finished in the running cycle
+  uint8_t cycle_commands_{0};      // Table and batch commands finished in the running cycle, with retries
+  uint8_t cycle_responses_{0};     // Transactions that returned a frame in the running cycle
+  uint16_t cycle_good_{0};         // Registers read with a good CRC in the running cycle
+  uint8_t retries_left_{0};
+  uint8_t current_register_{0};
+  uint8_t current_cell_{0};
+  bool step_ready_{false};
+  PollStep step_{};
+  BatchItem batch_items_[BATCH_MAX_REGISTERS];
+  uint8_t batch_count_{0};
+
+  // Presence and the inserted pack
+  bool pack_present_{false};
+  uint8_t absent_cycles_{0};
+  BatchSupport batch_support_{BATCH_UNKNOWN};  // Probed on the first cycle with a pack
+  uint8_t cell_count_{0};
+  uint8_t detect_count_{0};
+  uint32_t detect_cells_mv_{0};
+  uint16_t detect_pack_mv_{0};
+
+  uint16_t raw_values_[REG_COUNT]{0};
+  uint16_t cell_raw_[MAX_CELLS]{0};
+  uint32_t last_good_[REG_COUNT]{0};
+  uint32_t cell_last_good_[MAX_CELLS]{0};
+  uint16_t decoded_registers_{0};
+  uint16_t good_registers_{0};
+  uint16_t good_cells_{0};
+};
+
+}  // namespace xgt_battery
+}  // namespace esphome
@@ -0,0 +1,252 @@
+#pragma once
+
+// XGT serial protocol core: bit order conversion, framing, CRC, command construction and value decoding.
+// Header-only and free of ESPHome/ESP-IDF dependencies so the same code builds on the host (see tools/).
+
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace xgt_battery {
+
+static const uint8_t SHORT_FRAME_LENGTH = 8;
+static const uint8_t MAX_FRAME_LENGTH = 32;
+// Long frames in memory order: A5 A5 <type> <padding count in the low nibble> <payload> <16-bit sum, big
+// endian> <padding>, where the sum covers type, padding byte and payload (see check_crc()).
+static const uint8_t LONG_FRAME_OVERHEAD = 6;
+
+// Protocol commands from the original C++ code, in wire order (MSB first)
+static const uint8_t WAKE_BYTE = 0x0;
+static const uint8_t NUM_CHARGES_COMMAND[8] = {0x33, 0xC8, 0x3, 0x0, 0x2A, 0x0, 0x0, 0xCC};
+static const uint8_t CELL_SIZE_COMMAND[8] = {0x33, 0x27, 0xBB, 0x10, 0x0, 0x0, 0x0, 0xCC};
+static const uint8_t PARALLEL_COUNT_COMMAND[8] = {0x33, 0x67, 0xBB, 0x50, 0x0, 0x0, 0x0, 0xCC};
+static const uint8_t BATTERY_HEALTH_COMMAND[8] = {0x33, 0xC4, 0x3, 0x0, 0x26, 0x0, 0x0, 0xCC};
+static const uint8_t CHARGE_COMMAND[8] = {0x33, 0x13, 0x3, 0x80, 0x10, 0x0, 0x0, 0xCC};
+static const uint8_t TEMPERATURE_COMMAND[8] = {0x33, 0x3B, 0x3, 0xC0, 0x58, 0x0, 0x0, 0xCC};
+static const uint8_t PACK_VOLTAGE_COMMAND[8] = {0x33, 0x43, 0x3, 0xC0, 0x0, 0x0, 0x0, 0xCC};
+static const uint8_t CELL_VOLTAGE_COMMAND[8] = {0x33, 0x23, 0x03, 0xC0, 0x00, 0x0, 0x0, 0xCC};  // Base, see build_cell_command()
+
+// Transaction timing in milliseconds, matching the working implementation
+static const uint32_t WAKE_SETTLE_MS = 70;       // After the wake byte, before the first command
+static const uint32_t SHORT_SETTLE_MS = 15;      // After a short command, before reading
+static const uint32_t LONG_SETTLE_MS = 50;       // Model command needs more time
+static const uint32_t SHORT_RX_TIMEOUT_MS = 25;  // Restarted when the first byte arrives
+static const uint32_t LONG_RX_TIMEOUT_MS = 100;
+static const uint32_t RETRY_DELAY_MS = 50;
+static const uint8_t MAX_ATTEMPTS = 2;
+
+// Time to shift length bytes out at 8E1: start + 8 data + parity + stop = 11 bits per byte, plus 1ms of slack
+inline uint32_t wire_time_ms(uint8_t length, uint32_t baud) {
+  if (baud == 0) {
+    baud = 9600;
+  }
+  return (length * 11u * 1000u + baud - 1) / baud + 1;
+}
+
+// Reverse bit order (MSB first on the wire <-> LSB first in memory)
+inline uint8_t reverse_bits(uint8_t byte) {
+  static const uint8_t LOOKUP[16] = {0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe,
+                                     0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf};
+  return (LOOKUP[byte & 0b1111] << 4) | LOOKUP[byte >> 4];
+}
+
+inline void reverse_bits(uint8_t *buf, uint8_t length) {
+  for (uint8_t i = 0; i < length; ++i) {
+    buf[i] = reverse_bits(buf[i]);
+  }
+}
+
+// Checksum of a short frame in memory order: first byte plus bytes 2..7, modulo 256
+inline uint8_t short_frame_checksum(const uint8_t *frame) {
+  uint16_t crc = frame[0];
+  for (uint8_t i = 2; i < SHORT_FRAME_LENGTH; i++) {
+    crc += frame[i];
+  }
+  return crc % 256;
+}
+
+// Validate a bit-reversed response: short frames 0xCC <crc> ... 0x33 with an 8-bit sum in byte 1,
+// long frames 0xA5 0xA5 ... with padding count in the low nibble of byte 3 and a trailing 16-bit sum.
+// Only reads within length: noise on the line ends receptions at any length, padding counts included.
+inline bool check_crc(const uint8_t *rx_buf, uint8_t length) {
+  if (length == SHORT_FRAME_LENGTH && rx_buf[0] == 0xCC && rx_buf[7] == 0x33) {
+    // Short message type: anything before or after the 8 bytes is not part of the frame
+    return short_frame_checksum(rx_buf) == rx_buf[1];
+  }
+  if (length >= LONG_FRAME_OVERHEAD && rx_buf[0] == 0xA5 && rx_buf[1] == 0xA5) {
+    // Long message type: header, checksum and the padding it announces must all have been received
+    uint8_t padding = rx_buf[3] & 0xF;
+    if (length < padding + LONG_FRAME_OVERHEAD) {
+      return false;
+    }
+    length -= padding;  // size of data - number of padding bytes
+    uint16_t crc = 0;
+    for (uint8_t i = 2; i < length - 2; i++) {  // exclude A5A5 header and final word (CRC)
+      crc += rx_buf[i];
+    }
+    return (rx_buf[length - 2] << 8 | rx_buf[length - 1]) == crc;
+  }
+  return false;  // Invalid message format
+}
+
+enum FrameState : uint8_t {
+  FRAME_INCOMPLETE,  // Keep reading
+  FRAME_COMPLETE,    // Last byte of a short frame received
+  FRAME_NEEDS_IDLE,  // Long frame with header, CRC and padding in; ends when the line goes idle
+};
+
+// Incremental framing over the bit-reversed bytes received so far. Long frames carry no total length
+// we can check against, so the caller ends them on an inter-byte idle gap.
+inline FrameState frame_state(const uint8_t *buf, uint8_t length) {
+  if (length >= SHORT_FRAME_LENGTH && buf[0] == 0xCC) {
+    return buf[7] == 0x33 ? FRAME_COMPLETE : FRAME_INCOMPLETE;
+  }
+  if (length >= 4 && buf[0] == 0xA5 && buf[1] == 0xA5) {
+    uint8_t padding = buf[3] & 0xF;
+    return length >= padding + LONG_FRAME_OVERHEAD ? FRAME_NEEDS_IDLE : FRAME_INCOMPLETE;
+  }
+  return FRAME_INCOMPLETE;
+}
+
+// Minimum number of bytes still to come before frame_state() can change, so a receiver can wait for
+// them in one go: the rest of a short frame or of a long frame's header and fixed part. 1 while the
+// start byte is unknown or the frame only needs an idle gap.
+inline uint8_t frame_bytes_missing(const uint8_t *buf, uint8_t length) {
+  if (length == 0) {
+    return 1;
+  }
+  if (buf[0] == 0xCC && length < SHORT_FRAME_LENGTH) {
+    return SHORT_FRAME_LENGTH - length;
+  }
+  if (buf[0] == 0xA5) {
+    if (length < 4) {
+      return 4 - length;
+    }
+    uint8_t needed = (buf[3] & 0xF) + LONG_FRAME_OVERHEAD;
+    if (buf[1] == 0xA5 && length < needed) {
+      return needed - length;
+    }
+  }
+  return 1;
+}
+
+// Fill in the checksum of a short command given in memory order and convert it to wire order in place
+inline void encode_short_command(uint8_t *frame) {
+  frame[1] = short_frame_checksum(frame);
+  reverse_bits(frame, SHORT_FRAME_LENGTH);
+}
+
+// Register addresses are bytes 2..5 of a short command in memory order: e.g. C0 03 00 00 for the pack
+// voltage, C0 03 <cell * 2> 00 for a cell. The commands above are these addresses, framed and reversed.
+static const uint8_t ADDRESS_LENGTH = 4;
+
+// Short read command for any register address, in wire order with checksum
+inline void build_short_command(const uint8_t *address, uint8_t *command) {
+  command[0] = 0xCC;
+  memcpy(command + 2, address, ADDRESS_LENGTH);
+  command[6] = 0x00;
+  command[7] = 0x33;
+  encode_short_command(command);
+}
+
+// Register address of a wire-order short command
+inline void command_address(const uint8_t *command, uint8_t *address) {
+  for (uint8_t i = 0; i < ADDRESS_LENGTH; i++) {
+    address[i] = reverse_bits(command[2 + i]);
+  }
+}
+
+// Cell voltage command for cell 1..10 from the wire-order base command
+inline void build_cell_command(const uint8_t *base, uint8_t cell, uint8_t *command) {
+  uint8_t address[ADDRESS_LENGTH];
+  command_address(base, address);
+  address[2] = cell * 2;
+  build_short_command(address, command);
+}
+
+// Batched read: one long request carrying the 4 address bytes (2..5 of the short command) of up to
+// BATCH_MAX_REGISTERS registers, answered by one long frame with the 2 data bytes (4..5 of the short
+// response) per register in request order. Packs that do not answer it are polled with short commands.
+static const uint8_t BATCH_READ_REQUEST = 0x10;
+static const uint8_t BATCH_READ_RESPONSE = 0x90;
+static const uint8_t BATCH_MAX_REGISTERS = (MAX_FRAME_LENGTH - LONG_FRAME_OVERHEAD) / 4;
+
+// Build a long frame of any type without padding and convert it to wire order. Returns the frame length;
+// payload_length is at most MAX_FRAME_LENGTH - LONG_FRAME_OVERHEAD.
+inline uint8_t encode_long_frame(uint8_t type, const uint8_t *payload, uint8_t payload_length, uint8_t *frame) {
+  frame[0] = 0xA5;
+  frame[1] = 0xA5;
+  frame[2] = type;
+  frame[3] = 0;
+  memcpy(frame + 4, payload, payload_length);
+  uint8_t length = 4 + payload_length;
+  uint16_t crc = 0;
+  for (uint8_t i = 2; i < length; i++) {
+    crc += frame[i];
+  }
+  frame[length++] = crc >> 8;
+  frame[length++] = crc & 0xFF;
+  reverse_bits(frame, length);
+  return length;
+}
+
+// Payload of a validated, bit-reversed long frame, excluding header, checksum and padding
+inline uint8_t long_frame_payload_length(const uint8_t *buf, uint8_t length) {
+  if (length < LONG_FRAME_OVERHEAD || length < (buf[3] & 0xF) + LONG_FRAME_OVERHEAD) {
+    return 0;
+  }
+  return length - (buf[3] & 0xF) - LONG_FRAME_OVERHEAD;
+}
+
+
+// Batched read request for count wire-order short commands
+inline uint8_t build_batch_command(const uint8_t *const *commands, uint8_t count, uint8_t *frame) {
+  uint8_t payload[BATCH_MAX_REGISTERS * ADDRESS_LENGTH];
+  for (uint8_t i = 0; i < count; i++) {
+    command_address(commands[i], payload + i * ADDRESS_LENGTH);
+  }
+  return encode_long_frame(BATCH_READ_REQUEST, payload, count * ADDRESS_LENGTH, frame);
+}
+
+// Check a validated, bit-reversed batch response for count registers
+inline bool is_batch_response(const uint8_t *buf, uint8_t length, uint8_t count) {
+  return length >= LONG_FRAME_OVERHEAD && buf[0] == 0xA5 && buf[1] == 0xA5 && buf[2] == BATCH_READ_RESPONSE &&
+         long_frame_payload_length(buf, length) == count * 2;
+}
+
+// Rebuild the memory-order short response of register index from a batch response, so the
+// register's normal decoder applies
+inline void batch_short_response(const uint8_t *buf, const uint8_t *command, uint8_t index, uint8_t *response) {
+  response[0] = 0xCC;
+  response[2] = reverse_bits(command[2]);
+  response[3] = reverse_bits(command[3]);
+  response[4] = buf[4 + index * 2];
+  response[5] = buf[5 + index * 2];
+  response[6] = 0x00;
+  response[7] = 0x33;
+  response[1] = short_frame_checksum(response);
+}
+
+// A received frame a short command's register can be decoded from: exactly one terminated short frame
+inline bool is_short_frame(const uint8_t *buf, uint8_t length) {
+  return length == SHORT_FRAME_LENGTH && buf[0] == 0xCC && buf[7] == 0x33;
+}
+
+// Register value extraction from a bit-reversed short response
+inline uint16_t decode_le16(const uint8_t *buf) { return buf[4] | (buf[5] << 8); }
+inline uint16_t decode_byte4(const uint8_t *buf) { return buf[4]; }
+inline uint16_t decode_byte5(const uint8_t *buf) { return buf[5]; }
+
+inline float scale_raw(uint16_t raw, float scale, float offset) { return raw * scale + offset; }
+
+// State of health in percent. Match INO file exactly: uses the raw cell size (40 for 4000mAh)
+inline uint16_t battery_health(uint16_t raw, uint16_t raw_cell_size, uint16_t parallel_cnt) {
+  if (raw_cell_size > 0 && parallel_cnt > 0) {
+    return raw / (raw_cell_size * parallel_cnt);
+  }
+  // Fallback if values are invalid
+  return (raw * 100) / 255;
+}
+
+}  // namespace xgt_battery
+}  // namespace esphome
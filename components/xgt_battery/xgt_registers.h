@@ -0,0 +1,81 @@
+#pragma once
+
+// The register table: which command reads each register, how its answer is decoded and scaled, and how
+// often and in what order it is polled. The component, the poller (xgt_poller.h) and the host tools all
+// index this one table by Register.
+
+#include "xgt_protocol.h"
+
+#include <cstdint>
+
+namespace esphome {
+namespace xgt_battery {
+
+// How often a register is re-read. Static registers are read when a pack is detected and then
+// only every static_interval, slow ones every slow_interval, fast ones on every update_interval.
+enum PollClass : uint8_t {
+  POLL_STATIC = 0,
+  POLL_SLOW,
+  POLL_FAST,
+  POLL_CLASS_COUNT,
+};
+
+// Registers that can be assigned a poll class
+enum Register : uint8_t {
+  REG_NUM_CHARGES = 0,
+  REG_CELL_SIZE,
+  REG_PARALLEL_COUNT,
+  REG_BATTERY_HEALTH,
+  REG_CHARGE,
+  REG_TEMPERATURE,
+  REG_PACK_VOLTAGE,
+  REG_CELL_VOLTAGES,
+  REG_COUNT,
+};
+
+// Series cells a pack can have, numbered 1..MAX_CELLS on the wire
+static const uint8_t MAX_CELLS = 10;
+
+// One row per register, polled in table order. value = decode(response) * scale + offset
+struct RegisterInfo {
+  const char *name;
+  const uint8_t *command;  // SHORT_FRAME_LENGTH bytes, wire order
+  uint16_t (*decode)(const uint8_t *buf);
+  float scale;
+  float offset;
+  PollClass poll_class;
+  uint16_t gap_ms;      // Bus idle time before the command
+  uint16_t depends_on;  // Other registers this one's value is derived from, as (1 << Register) bits
+};
+
+static constexpr RegisterInfo REGISTERS[REG_COUNT] = {
+    // REG_NUM_CHARGES
+    {"num_charges", NUM_CHARGES_COMMAND, &decode_le16, 1.0f, 0.0f, POLL_STATIC, 100, 0},
+    // REG_CELL_SIZE: 40 raw -> 4000mAh for 4Ah battery
+    {"cell_size", CELL_SIZE_COMMAND, &decode_byte5, 100.0f, 0.0f, POLL_STATIC, 100, 0},
+    // REG_PARALLEL_COUNT
+    {"parallel_count", PARALLEL_COUNT_COMMAND, &decode_byte4, 1.0f, 0.0f, POLL_STATIC, 50, 0},
+    // REG_BATTERY_HEALTH: raw, scaled by cell size and parallel count with battery_health()
+    {"battery_health", BATTERY_HEALTH_COMMAND, &decode_le16, 1.0f, 0.0f, POLL_SLOW, 50,
+     (1 << REG_CELL_SIZE) | (1 << REG_PARALLEL_COUNT)},
+    // REG_CHARGE: 0..25500 -> percent
+    {"battery_charge", CHARGE_COMMAND, &decode_le16, 1.0f / 255.0f, 0.0f, POLL_FAST, 50, 0},
+    // REG_TEMPERATURE: deci-Kelvin, -30 + (raw - 2431) / 10 in the working implementation
+    {"battery_temperature", TEMPERATURE_COMMAND, &decode_le16, 0.1f, -273.1f, POLL_SLOW, 50, 0},
+    // REG_PACK_VOLTAGE: millivolts
+    {"battery_voltage", PACK_VOLTAGE_COMMAND, &decode_le16, 0.001f, 0.0f, POLL_FAST, 50, 0},
+    // REG_CELL_VOLTAGES: base command, cell number patched in by build_cell_command()
+    {"cell_voltage", CELL_VOLTAGE_COMMAND, &decode_le16, 0.001f, 0.0f, POLL_FAST, 50, 0},
+};
+
+// Published value of reg from the raw values of one pack, indexed by Register
+inline float register_value(uint8_t reg, const uint16_t *raw_values) {
+  const RegisterInfo &desc = REGISTERS[reg];
+  if (reg == REG_BATTERY_HEALTH) {
+    return battery_health(raw_values[reg], raw_values[REG_CELL_SIZE], raw_values[REG_PARALLEL_COUNT]);
+  }
+  return scale_raw(raw_values[reg], desc.scale, desc.offset);
+}
+
+}  // namespace xgt_battery
+}  // namespace esphome
@@ -0,0 +1,49 @@
+#pragma once
+
+// Single-writer sequence lock: hands a plain struct from the polling task to loop() without a mutex.
+// The writer never waits. A reader that overlaps a write sees the sequence change and simply tries
+// again on its next call, which for a once-per-cycle snapshot read from loop() costs nothing.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace esphome {
+namespace xgt_battery {
+
+template<typename T> class SeqLock {
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock copies T bytewise");
+
+ public:
+  // Only ever called from one task
+  void write(const T &value) {
+    uint32_t seq = this->seq_.load(std::memory_order_relaxed);
+    this->seq_.store(seq + 1, std::memory_order_relaxed);  // Odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&this->value_, &value, sizeof(T));
+    this->seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // Copies a value written since *last_seq into out. False if there is none yet or a write overlapped.
+  bool read(T *out, uint32_t *last_seq) const {
+    uint32_t seq = this->seq_.load(std::memory_order_acquire);
+    if ((seq & 1) != 0 || seq == *last_seq) {
+      return false;
+    }
+    memcpy(out, &this->value_, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (this->seq_.load(std::memory_order_relaxed) != seq) {
+      return false;
+    }
+    *last_seq = seq;
+    return true;
+  }
+
+ protected:
+  std::atomic<uint32_t> seq_{0};
+  T value_{};
+};
+
+}  // namespace xgt_battery
+}  // namespace esphome
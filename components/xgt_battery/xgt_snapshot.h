@@ -0,0 +1,44 @@
+#pragma once
+
+// The readings of one pack after a cycle as a single fixed-layout record: raw register values as decoded
+// (mV, deci-Kelvin, ...), validity bits and value ages, no floats. Scaling happens only when publishing.
+// Trivially copyable, so it is handed between tasks and exported bytewise; a layout change bumps
+// PACK_SNAPSHOT_VERSION.
+
+#include <cstdint>
+#include <type_traits>
+
+namespace esphome {
+namespace xgt_battery {
+
+static const uint8_t PACK_SNAPSHOT_VERSION = 1;
+static const uint8_t SNAPSHOT_REGISTERS = 8;  // XGTBattery's REG_COUNT
+static const uint8_t SNAPSHOT_CELLS = 10;
+
+struct PackSnapshot {
+  uint32_t time_ms;        // millis() at the end of the cycle
+  uint8_t version;         // PACK_SNAPSHOT_VERSION
+  uint8_t cell_count;      // Detected series cells, 0 = unknown
+  uint16_t registers_valid;  // (1 << register): read with a good CRC since this pack was detected
+  uint16_t cells_valid;      // (1 << cell)
+  uint16_t raw[SNAPSHOT_REGISTERS];
+  uint16_t cell_mv[SNAPSHOT_CELLS];
+  // Seconds since the last good read at time_ms, rounded up so a value never looks fresher than it is,
+  // saturating at UINT16_MAX (18 hours)
+  uint16_t register_age_s[SNAPSHOT_REGISTERS];
+  uint16_t cell_age_s[SNAPSHOT_CELLS];
+
+  static uint16_t age_s(uint32_t time_ms, uint32_t last_good_ms) {
+    uint32_t age = (time_ms - last_good_ms + 999) / 1000;
+    return age < UINT16_MAX ? age : UINT16_MAX;
+  }
+  // Age of a value at now, in ms (at most a second more than it is)
+  uint32_t register_age_ms(uint8_t reg, uint32_t now) const { return now - this->time_ms + this->register_age_s[reg] * 1000u; }
+  uint32_t cell_age_ms(uint8_t cell, uint32_t now) const { return now - this->time_ms + this->cell_age_s[cell] * 1000u; }
+};
+
+static_assert(std::is_trivially_copyable<PackSnapshot>::value, "PackSnapshot is copied bytewise");
+static_assert(sizeof(PackSnapshot) == 84, "PackSnapshot layout changed, bump PACK_SNAPSHOT_VERSION");
+
+}  // namespace xgt_battery
+}  // namespace esphome
@@ -0,0 +1,117 @@
+#pragma once
+
+// Adaptive bus timing: learns how fast the battery starts answering each register and shrinks the
+// first-byte timeout and inter-command gaps toward a safety margin above the observed p99, backing off
+// as soon as CRC failures or timeouts show up. Off unless adaptive_timing is set; xgt_harness --adaptive 1
+// runs it against the simulator.
+
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace xgt_battery {
+
+class AdaptiveTiming {
+ public:
+  static const uint8_t SLOTS = 8;             // One per register
+  static const uint8_t BUCKETS = 32;          // 1ms onset buckets, the last one collects everything above
+  static const uint16_t MIN_SAMPLES = 16;     // Keep the defaults until this many onsets were seen
+  static const uint32_t MIN_TIMEOUT_MS = 5;   // Never wait less than this for the first byte
+  static const uint32_t MIN_GAP_MS = 10;      // Never put commands closer together than this
+  static const uint8_t GAP_SCALE_ONE = 16;    // Gap scale is in 1/16 of the configured gap
+
+  void set_margin_ms(uint32_t margin_ms) { this->margin_ms_ = margin_ms; }
+
+  // Time from the end of the command to the first response byte
+  void record_onset(uint8_t slot, uint32_t onset_ms) {
+    if (slot >= SLOTS) {
+      return;
+    }
+    uint8_t *histogram = this->histogram_[slot];
+    uint8_t bucket = onset_ms < BUCKETS ? onset_ms : BUCKETS - 1;
+    if (histogram[bucket] == UINT8_MAX) {
+      // Halve the slot so recent behaviour keeps its weight and counts stay in 8 bits
+      this->samples_[slot] = 0;
+      for (uint8_t i = 0; i < BUCKETS; i++) {
+        histogram[i] /= 2;
+        this->samples_[slot] += histogram[i];
+      }
+    }
+    histogram[bucket]++;
+    this->samples_[slot]++;
+  }
+
+  // A CRC failure or timeout: relearn this slot from the defaults and widen the gaps again
+  void record_failure(uint8_t slot) {
+    if (slot < SLOTS) {
+      memset(this->histogram_[slot], 0, BUCKETS);
+      this->samples_[slot] = 0;
+    }
+    this->gap_scale_ = this->gap_scale_ * 2 > GAP_SCALE_ONE ? GAP_SCALE_ONE : this->gap_scale_ * 2;
+    this->cycle_failures_++;
+  }
+
+  // Called once per polling cycle: a clean cycle tightens the gaps by 1/16 of the configured value
+  void cycle_complete() {
+    if (this->cycle_failures_ == 0 && this->gap_scale_ > 1) {
+      this->gap_scale_--;
+    }
+    this->cycle_failures_ = 0;
+  }
+
+  // Onset below which 99% of the recorded responses started, 0 while not enough samples
+  uint32_t p99_onset_ms(uint8_t slot) const {
+    if (slot >= SLOTS || this->samples_[slot] < MIN_SAMPLES) {
+      return 0;
+    }
+    uint32_t needed = (this->samples_[slot] * 99 + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+      seen += this->histogram_[slot][i];
+      if (seen >= needed) {
+        return i + 1;  // Upper edge of the bucket
+      }
+    }
+    return BUCKETS;
+  }
+
+  uint32_t first_byte_timeout_ms(uint8_t slot, uint32_t default_ms) const {
+    uint32_t p99 = this->p99_onset_ms(slot);
+    if (p99 == 0) {
+      return default_ms;
+    }
+    uint32_t timeout = p99 + this->margin_ms_;
+    if (timeout < MIN_TIMEOUT_MS) {
+      timeout = MIN_TIMEOUT_MS;
+    }
+    return timeout < default_ms ? timeout : default_ms;
+  }
+
+  uint32_t gap_ms(uint32_t configured_ms) const {
+    uint32_t gap = configured_ms * this->gap_scale_ / GAP_SCALE_ONE;
+    if (gap < MIN_GAP_MS) {
+      gap = MIN_GAP_MS;
+    }
+    return gap < configured_ms ? gap : configured_ms;
+  }
+
+  // Largest learned p99 across registers, for diagnostics
+  uint32_t max_p99_onset_ms() const {
+    uint32_t result = 0;
+    for (uint8_t slot = 0; slot < SLOTS; slot++) {
+      uint32_t p99 = this->p99_onset_ms(slot);
+      result = p99 > result ? p99 : result;
+    }
+    return result;
+  }
+
+ protected:
+  uint8_t histogram_[SLOTS][BUCKETS]{};
+  uint16_t samples_[SLOTS]{};
+  uint32_t margin_ms_{5};
+  uint8_t gap_scale_{GAP_SCALE_ONE};
+  uint16_t cycle_failures_{0};
+};
+
+}  // namespace xgt_battery
+}  // namespace esphome
@@ -0,0 +1,169 @@
+#pragma once
+
+// Binary frame trace: the last N transactions with their command and raw response bytes (both in wire
+// order, as on the line), timestamp, register and result. A fixed-size RAM ring, written once per
+// transaction instead of per-byte log lines. xgt_replay reads the exported blob back.
+//
+// Exported as a compact blob: "XGTT", version, frame count, then per frame (oldest first)
+// time_ms (u32 LE), reg, result, attempts, tx_length, rx_length, tx bytes, rx bytes.
+
+#include "xgt_protocol.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+namespace esphome {
+namespace xgt_battery {
+
+static const uint8_t TRACE_BLOB_MAGIC[4] = {'X', 'G', 'T', 'T'};
+static const uint8_t TRACE_BLOB_VERSION = 1;
+static const uint8_t TRACE_BLOB_HEADER_LENGTH = 6;
+static const uint8_t TRACE_FRAME_HEADER_LENGTH = 9;
+
+struct TraceFrame {
+  uint32_t time_ms;  // millis() when the transaction finished
+  uint8_t reg;       // Register, REG_COUNT for the wake byte
+  int8_t result;     // 0 = ok, 1 = short/no response, -1 = CRC error
+  uint8_t attempts;
+  uint8_t tx_length;
+  uint8_t rx_length;
+  uint8_t tx[MAX_FRAME_LENGTH];
+  uint8_t rx[MAX_FRAME_LENGTH];
+};
+
+class FrameTrace {
+ public:
+  // Allocates the ring; a capacity of 0 disables recording
+  void init(uint8_t capacity) {
+    this->frames_.reset(capacity > 0 ? new TraceFrame[capacity] : nullptr);
+    this->capacity_ = capacity;
+    this->clear();
+  }
+
+  void clear() {
+    this->head_ = 0;
+    this->count_ = 0;
+  }
+
+  void record(uint32_t time_ms, uint8_t reg, int8_t result, uint8_t attempts, const uint8_t *tx, uint8_t tx_length,
+              const uint8_t *rx, uint8_t rx_length) {
+    if (this->capacity_ == 0) {
+      return;
+    }
+    TraceFrame &frame = this->frames_[this->head_];
+    frame.time_ms = time_ms;
+    frame.reg = reg;
+    frame.result = result;
+    frame.attempts = attempts;
+    frame.tx_length = tx_length < MAX_FRAME_LENGTH ? tx_length : MAX_FRAME_LENGTH;
+    frame.rx_length = rx_length < MAX_FRAME_LENGTH ? rx_length : MAX_FRAME_LENGTH;
+    memcpy(frame.tx, tx, frame.tx_length);
+    memcpy(frame.rx, rx, frame.rx_length);
+
+    this->head_ = (this->head_ + 1) % this->capacity_;
+    if (this->count_ < this->capacity_) {
+      this->count_++;
+    }
+  }
+
+  uint8_t size() const { return this->count_; }
+  uint8_t capacity() const { return this->capacity_; }
+
+  // Oldest first
+  const TraceFrame &at(uint8_t index) const {
+    return this->frames_[(this->head_ + this->capacity_ - this->count_ + index) % this->capacity_];
+  }
+
+  size_t blob_size() const {
+    size_t size = TRACE_BLOB_HEADER_LENGTH;
+    for (uint8_t i = 0; i < this->count_; i++) {
+      size += TRACE_FRAME_HEADER_LENGTH + this->at(i).tx_length + this->at(i).rx_length;
+    }
+    return size;
+  }
+
+  // Write the blob into out, which must hold blob_size() bytes. Returns the number of bytes written.
+  size_t write_blob(uint8_t *out) const {
+    uint8_t *pos = out;
+    memcpy(pos, TRACE_BLOB_MAGIC, sizeof(TRACE_BLOB_MAGIC));
+    pos += sizeof(TRACE_BLOB_MAGIC);
+    *pos++ = TRACE_BLOB_VERSION;
+    *pos++ = this->count_;
+    for (uint8_t i = 0; i < this->count_; i++) {
+      const TraceFrame &frame = this->at(i);
+      for (uint8_t shift = 0; shift < 32; shift += 8) {
+        *pos++ = frame.time_ms >> shift;
+      }
+      *pos++ = frame.reg;
+      *pos++ = static_cast<uint8_t>(frame.result);
+      *pos++ = frame.attempts;
+      *pos++ = frame.tx_length;
+      *pos++ = frame.rx_length;
+      memcpy(pos, frame.tx, frame.tx_length);
+      pos += frame.tx_length;
+      memcpy(pos, frame.rx, frame.rx_length);
+      pos += frame.rx_length;
+    }
+    return pos - out;
+  }
+
+ protected:
+  std::unique_ptr<TraceFrame[]> frames_;
+  uint8_t capacity_{0};
+  uint8_t head_{0};  // Next slot to write
+  uint8_t count_{0};
+};
+
+// Reads frames back from a blob, for the replay tool
+class TraceReader {
+ public:
+  TraceReader(const uint8_t *data, size_t length) : pos_(data), end_(data + length) {
+    if (length < TRACE_BLOB_HEADER_LENGTH || memcmp(data, TRACE_BLOB_MAGIC, sizeof(TRACE_BLOB_MAGIC)) != 0 ||
+        data[4] != TRACE_BLOB_VERSION) {
+      this->pos_ = this->end_;
+      return;
+    }
+    this->valid_ = true;
+    this->count_ = data[5];
+    this->pos_ += TRACE_BLOB_HEADER_LENGTH;
+  }
+
+  bool valid() const { return this->valid_; }
+  uint8_t count() const { return this->count_; }
+
+  // False at the end of the blob or on a truncated/corrupt frame
+  bool next(TraceFrame *frame) {
+    if (this->end_ - this->pos_ < TRACE_FRAME_HEADER_LENGTH) {
+      return false;
+    }
+    const uint8_t *pos = this->pos_;
+    frame->time_ms = pos[0] | (pos[1] << 8) | (pos[2] << 16) | (static_cast<uint32_t>(pos[3]) << 24);
+    frame->reg = pos[4];
+    frame->result = static_cast<int8_t>(pos[5]);
+    frame->attempts = pos[6];
+    frame->tx_length = pos[7];
+    frame->rx_length = pos[8];
+    pos += TRACE_FRAME_HEADER_LENGTH;
+    if (frame->tx_length > MAX_FRAME_LENGTH || frame->rx_length > MAX_FRAME_LENGTH ||
+        this->end_ - pos < frame->tx_length + frame->rx_length) {
+      this->pos_ = this->end_;
+      return false;
+    }
+    memcpy(frame->tx, pos, frame->tx_length);
+    pos += frame->tx_length;
+    memcpy(frame->rx, pos, frame->rx_length);
+    this->pos_ = pos + frame->rx_length;
+    return true;
+  }
+
+ protected:
+  const uint8_t *pos_;
+  const uint8_t *end_;
+  bool valid_{false};
+  uint8_t count_{0};
+};
+
+}  // namespace xgt_battery
+}  // namespace esphome
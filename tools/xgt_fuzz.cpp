@@ -0,0 +1,364 @@
+// Fuzz target for the receive path of the protocol core: bit reversal, incremental framing, check_crc(),
+// batch response handling and register decode, run as XGTBattery runs them over one reception. Every input
+// is the bytes of one reception as they came off the wire (MSB first), the end of the input being the
+// receive timeout or idle gap. Each step works on an exactly sized copy of what it may read, so the
+// sanitizers report any access past the received bytes, and properties the component relies on are checked.
+//
+// Built two ways (see CMakeLists.txt):
+//   -DXGT_LIBFUZZER=ON (clang): a libFuzzer binary, e.g. xgt_fuzz -max_len=40 corpus/
+//   otherwise a standalone driver that runs the seed corpus, the files given and random mutations of
+//   them, to be used where libFuzzer is not available:
+//     xgt_fuzz [--iterations N] [--seed S] [--write-corpus DIR] [file...]
+// The seed corpus is built from the real command and response formats; --write-corpus saves it as files
+// for libFuzzer. Both under AddressSanitizer and UndefinedBehaviorSanitizer where the compiler has them.
+
+#include "xgt_protocol.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef XGT_LIBFUZZER
+#include <sys/stat.h>
+#endif
+
+using namespace esphome::xgt_battery;
+
+#define FUZZ_CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      std::abort(); \
+    } \
+  } while (0)
+
+namespace {
+
+// The register commands the component sends, in wire order
+const uint8_t *const COMMANDS[] = {NUM_CHARGES_COMMAND,    CELL_SIZE_COMMAND, PARALLEL_COUNT_COMMAND,
+                                   BATTERY_HEALTH_COMMAND, CHARGE_COMMAND,    TEMPERATURE_COMMAND,
+                                   PACK_VOLTAGE_COMMAND,   CELL_VOLTAGE_COMMAND};
+const uint8_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+// Copy of the first length bytes in a buffer of exactly that size
+std::unique_ptr<uint8_t[]> exact_copy(const uint8_t *buf, uint8_t length) {
+  std::unique_ptr<uint8_t[]> copy(new uint8_t[length > 0 ? length : 1]);
+  memcpy(copy.get(), buf, length);
+  return copy;
+}
+
+void check_batch_response(const uint8_t *buf, uint8_t length) {
+  uint8_t payload = long_frame_payload_length(buf, length);
+  for (uint8_t count = 1; count <= BATCH_MAX_REGISTERS; count++) {
+    if (!is_batch_response(buf, length, count)) {
+      continue;
+    }
+    FUZZ_CHECK(payload == count * 2);
+    for (uint8_t i = 0; i < count; i++) {
+      // The rebuilt short response must pass the same checks as a polled one and carry the batch's bytes
+      uint8_t response[SHORT_FRAME_LENGTH];
+      batch_short_response(buf, COMMANDS[i % COMMAND_COUNT], i, response);
+      auto exact = exact_copy(response, SHORT_FRAME_LENGTH);
+      FUZZ_CHECK(is_short_frame(exact.get(), SHORT_FRAME_LENGTH));
+      FUZZ_CHECK(check_crc(exact.get(), SHORT_FRAME_LENGTH));
+      FUZZ_CHECK(decode_le16(exact.get()) == (buf[4 + i * 2] | buf[5 + i * 2] << 8));
+    }
+  }
+}
+
+void check_reception(const uint8_t *wire, size_t size) {
+  // The component's receive buffer holds MAX_FRAME_LENGTH bytes and drops the rest
+  uint8_t length = size < MAX_FRAME_LENGTH ? size : MAX_FRAME_LENGTH;
+  uint8_t buf[MAX_FRAME_LENGTH];
+  for (uint8_t i = 0; i < length; i++) {
+    buf[i] = reverse_bits(wire[i]);
+    FUZZ_CHECK(reverse_bits(buf[i]) == wire[i]);
+  }
+
+  // Framing over every prefix, stopping where the receiver would: a complete short frame ends the reception
+  FrameState states[MAX_FRAME_LENGTH + 1];
+  uint8_t missing[MAX_FRAME_LENGTH + 1];
+  uint8_t received = 0;
+  for (;;) {
+    auto prefix = exact_copy(buf, received);
+    states[received] = frame_state(prefix.get(), received);
+    missing[received] = frame_bytes_missing(prefix.get(), received);
+    FUZZ_CHECK(missing[received] >= 1 && missing[received] <= MAX_FRAME_LENGTH);
+    if (states[received] == FRAME_COMPLETE || received == length) {
+      break;
+    }
+    received++;
+  }
+  FUZZ_CHECK(states[received] != FRAME_COMPLETE || received == SHORT_FRAME_LENGTH);
+  // A receiver waiting for frame_bytes_missing() bytes in one go must not run past a frame's end
+  for (uint8_t n = 0; n < received; n++) {
+    for (uint8_t k = 1; k < missing[n] && n + k <= received; k++) {
+      FUZZ_CHECK(states[n + k] == states[n]);
+    }
+  }
+
+  // Validation and decode of what was received, then of the whole input as replayed from a trace
+  for (uint8_t frame_length : {received, length}) {
+    auto frame = exact_copy(buf, frame_length);
+    const uint8_t *rx = frame.get();
+    uint8_t payload = long_frame_payload_length(rx, frame_length);
+    FUZZ_CHECK(payload == 0 || payload + LONG_FRAME_OVERHEAD <= frame_length);
+    if (!check_crc(rx, frame_length)) {
+      continue;
+    }
+    if (rx[0] == 0xCC) {
+      FUZZ_CHECK(is_short_frame(rx, frame_length));
+      volatile float value = scale_raw(decode_le16(rx), 0.001f, 0.0f) + decode_byte4(rx) + decode_byte5(rx);
+      (void) value;
+    } else {
+      FUZZ_CHECK(rx[0] == 0xA5 && rx[1] == 0xA5 && !is_short_frame(rx, frame_length));
+      FUZZ_CHECK(payload + LONG_FRAME_OVERHEAD + (rx[3] & 0xF) == frame_length);
+      check_batch_response(rx, frame_length);
+    }
+  }
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  check_reception(data, size);
+  return 0;
+}
+
+#ifndef XGT_LIBFUZZER
+namespace {
+
+using Input = std::vector<uint8_t>;
+
+// Long frame in memory order with padding padding bytes announced in byte 3, converted to wire order
+Input long_frame(uint8_t type, const uint8_t *payload, uint8_t payload_length, uint8_t padding) {
+  uint8_t frame[MAX_FRAME_LENGTH];
+  uint8_t length = encode_long_frame(type, payload, payload_length, frame);
+  reverse_bits(frame, length);
+  frame[3] = padding;
+  uint16_t crc = 0;
+  for (uint8_t i = 2; i < length - 2; i++) {
+    crc += frame[i];
+  }
+  frame[length - 2] = crc >> 8;
+  frame[length - 1] = crc & 0xFF;
+  for (uint8_t i = 0; i < padding; i++) {
+    frame[length++] = 0x00;
+  }
+  reverse_bits(frame, length);
+  return Input(frame, frame + length);
+}
+
+// What the component sends and what packs answer: the wake byte, every register and cell command, short
+// responses with typical and extreme values, batch requests and responses with and without padding, and
+// the cut-off frames a noisy line leaves behind
+std::vector<Input> seed_corpus() {
+  std::vector<Input> corpus;
+  corpus.push_back({});
+  corpus.push_back({WAKE_BYTE});
+  std::vector<Input> commands;
+  for (uint8_t i = 0; i < COMMAND_COUNT; i++) {
+    commands.emplace_back(COMMANDS[i], COMMANDS[i] + SHORT_FRAME_LENGTH);
+  }
+  for (uint8_t cell = 1; cell <= 10; cell++) {
+    uint8_t command[SHORT_FRAME_LENGTH];
+    build_cell_command(CELL_VOLTAGE_COMMAND, cell, command);
+    commands.emplace_back(command, command + SHORT_FRAME_LENGTH);
+  }
+  for (const Input &command : commands) {
+    corpus.push_back(command);
+    for (uint16_t value : {0, 3612, 36120, 0xFFFF}) {
+      uint8_t response[SHORT_FRAME_LENGTH] = {0xCC, 0x00, reverse_bits(command[2]), reverse_bits(command[3]),
+                                              static_cast<uint8_t>(value & 0xFF), static_cast<uint8_t>(value >> 8),
+                                              0x00, 0x33};
+      encode_short_command(response);
+      corpus.emplace_back(response, response + SHORT_FRAME_LENGTH);
+    }
+  }
+  for (uint8_t count = 1; count <= BATCH_MAX_REGISTERS; count++) {
+    uint8_t request[MAX_FRAME_LENGTH];
+    uint8_t length = build_batch_command(COMMANDS, count, request);
+    corpus.emplace_back(request, request + length);
+    uint8_t payload[BATCH_MAX_REGISTERS * 2];
+    for (uint8_t i = 0; i < count * 2; i++) {
+      payload[i] = 0x40 + i;
+    }
+    for (uint8_t padding : {0, 1, 3}) {
+      if (count * 2 + LONG_FRAME_OVERHEAD + padding <= MAX_FRAME_LENGTH) {
+        corpus.push_back(long_frame(BATCH_READ_RESPONSE, payload, count * 2, padding));
+      }
+    }
+  }
+  size_t complete = corpus.size();
+  for (size_t i = 0; i < complete; i++) {
+    if (corpus[i].size() > 4) {
+      corpus.emplace_back(corpus[i].begin(), corpus[i].begin() + corpus[i].size() / 2);
+    }
+  }
+  return corpus;
+}
+
+// Random edits in memory order, where they mean something to the parser: bit flips, byte changes,
+// insertions, deletions, truncation, padding counts, repaired checksums and frames run together
+class Mutator {
+ public:
+  explicit Mutator(uint32_t seed) : state_(seed != 0 ? seed : 1) {}
+
+  uint32_t next() {
+    // xorshift32: deterministic for a given --seed
+    this->state_ ^= this->state_ << 13;
+    this->state_ ^= this->state_ >> 17;
+    this->state_ ^= this->state_ << 5;
+    return this->state_;
+  }
+
+  Input mutate(const Input &seed, const Input &other) {
+    Input buf = memory_order(seed);
+    uint8_t edits = 1 + this->next() % 4;
+    for (uint8_t e = 0; e < edits; e++) {
+      size_t at = buf.empty() ? 0 : this->next() % buf.size();
+      switch (this->next() % 9) {
+        case 0:
+          if (!buf.empty()) {
+            buf[at] ^= 1 << (this->next() % 8);
+          }
+          break;
+        case 1:
+          if (!buf.empty()) {
+            buf[at] = this->next();
+          }
+          break;
+        case 2:
+          buf.insert(buf.begin() + at, static_cast<uint8_t>(this->next()));
+          break;
+        case 3:
+          if (!buf.empty()) {
+            buf.erase(buf.begin() + at);
+          }
+          break;
+        case 4:
+          buf.resize(at);
+          break;
+        case 5:
+          if (buf.size() >= 4) {
+            buf[3] = (buf[3] & 0xF0) | (this->next() % 16);
+          }
+          break;
+        case 6:
+          if (buf.size() >= SHORT_FRAME_LENGTH) {
+            buf[1] = short_frame_checksum(buf.data());
+          }
+          break;
+        case 7:
+          if (buf.size() >= LONG_FRAME_OVERHEAD) {
+            size_t padding = buf[3] & 0xF;
+            size_t end = buf.size() >= padding + LONG_FRAME_OVERHEAD ? buf.size() - padding : buf.size();
+            uint16_t crc = 0;
+            for (size_t i = 2; i < end - 2; i++) {
+              crc += buf[i];
+            }
+            buf[end - 2] = crc >> 8;
+            buf[end - 1] = crc & 0xFF;
+          }
+          break;
+        default: {
+          Input tail = memory_order(other);
+          buf.insert(buf.end(), tail.begin(), tail.end());
+          break;
+        }
+      }
+    }
+    if (buf.size() > MAX_INPUT_LENGTH) {
+      buf.resize(MAX_INPUT_LENGTH);
+    }
+    reverse_bits(buf.data(), buf.size());
+    return buf;
+  }
+
+ protected:
+  // A little longer than the receive buffer, so the cut-off is exercised too
+  static const uint8_t MAX_INPUT_LENGTH = MAX_FRAME_LENGTH + 8;
+
+  static Input memory_order(const Input &input) {
+    Input buf(input.begin(), input.begin() + std::min<size_t>(input.size(), MAX_INPUT_LENGTH));
+    reverse_bits(buf.data(), buf.size());
+    return buf;
+  }
+
+  uint32_t state_;
+};
+
+bool write_corpus(const std::vector<Input> &corpus, const std::string &dir) {
+  mkdir(dir.c_str(), 0755);
+  for (size_t i = 0; i < corpus.size(); i++) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/seed-%03zu", i);
+    std::ofstream file(dir + name, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(corpus[i].data()), corpus[i].size());
+    if (!file) {
+      std::perror((dir + name).c_str());
+      return false;
+    }
+  }
+  std::printf("wrote %zu seed inputs to %s\n", corpus.size(), dir.c_str());
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t iterations = 1000000;
+  uint32_t seed = 1;
+  std::vector<Input> corpus = seed_corpus();
+  size_t seeds = corpus.size();
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--", 0) == 0) {
+      if (i + 1 >= argc) {
+        std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+        return 2;
+      }
+      const char *value = argv[++i];
+      if (arg == "--iterations") {
+        iterations = std::strtoul(value, nullptr, 10);
+      } else if (arg == "--seed") {
+        seed = std::strtoul(value, nullptr, 10);
+      } else if (arg == "--write-corpus") {
+        return write_corpus(std::vector<Input>(corpus.begin(), corpus.begin() + seeds), value) ? 0 : 1;
+      } else {
+        std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+        return 2;
+      }
+    } else {
+      std::ifstream file(arg, std::ios::binary);
+      if (!file) {
+        std::perror(arg.c_str());
+        return 1;
+      }
+      corpus.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (const Input &input : corpus) {
+    check_reception(input.data(), input.size());
+  }
+  Mutator mutator(seed);
+  for (size_t i = 0; i < iterations; i++) {
+    const Input &base = corpus[mutator.next() % corpus.size()];
+    const Input &other = corpus[mutator.next() % corpus.size()];
+    Input input = mutator.mutate(base, other);
+    check_reception(input.data(), input.size());
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("corpus: %zu inputs (%zu seeds), mutations: %zu (seed %u), %.1f s\n", corpus.size(), seeds, iterations,
+              seed, elapsed);
+  return 0;
+}
+#endif  // XGT_LIBFUZZER
@@ -0,0 +1,384 @@
+// Latency/throughput harness: runs the component's polling cycle (PackPoller from xgt_poller.h: wake,
+// register table, cell detection, batches, presence probe) against the pty battery simulator and reports
+// per-register latency histograms and full-cycle time. Every poll class is read on every cycle. Phase
+// timing comes from xgt_protocol.h, so it tracks changes to the component's constants.
+//   xgt_harness [--cycles n] [--delay ms] [--jitter ms] [--drop p] [--corrupt p] [--baud b] [--cells n]
+//               [--adaptive 0|1] [--batch 0|1] [--sim-batch 0|1] [--rx-wait 0|1] [--live 0|1]
+//               [--capture file] [--expect-cells n]
+// --batch reads registers and cells with batched long frames (falling back to short commands when the
+// simulator, configured with --sim-batch, does not answer them).
+// --rx-wait sleeps until bytes arrive or the phase times out (the polling task's wait in the UART driver)
+// instead of checking every millisecond like loop(); the receive wakeups per transaction are reported.
+// --live 1 runs live capture rows instead of full cycles: battery_voltage, battery_temperature and cell 1
+// back to back, with the wake byte only before the first row, and reports rows per second.
+// --capture writes the frames of the last 255 transactions as a trace blob for xgt_replay.
+// --expect-cells exits non-zero unless the pack was found on every cycle with n cells detected (for ctest).
+// What the poller reports (pack detected, cells detected, batch support, ...) is printed as it happens.
+
+#include "xgt_poller.h"
+#include "xgt_protocol.h"
+#include "xgt_sim.h"
+#include "xgt_timing.h"
+#include "xgt_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace esphome::xgt_battery;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Stats {
+  std::vector<double> latencies_ms;
+  uint32_t ok{0};
+  uint32_t crc_errors{0};
+  uint32_t no_response{0};
+};
+
+double elapsed_ms(Clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+void sleep_ms(double ms) {
+  if (ms > 0) {
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+  }
+}
+
+void drain(int fd) {
+  uint8_t byte;
+  while (read(fd, &byte, 1) == 1) {
+  }
+}
+
+AdaptiveTiming timing;
+bool adaptive = false;
+bool batch = false;
+bool rx_wait = false;
+bool live = false;
+uint64_t rx_wakeups = 0;
+uint64_t rx_transactions = 0;
+FrameTrace capture;
+auto harness_start = Clock::now();
+
+// One transaction with the component's phases: TX, then RX collect until frame completion or timeout
+// (first-byte timeout, restarted with the RX timeout on the first byte), one retry when nothing arrives,
+// then CRC validation. Returns 0 = ok, 1 = short/no response, -1 = CRC error.
+int8_t transact(int fd, const uint8_t *command, uint8_t length, uint8_t slot, bool expect_response, uint8_t *buf,
+                uint8_t *rx_length) {
+  *rx_length = 0;
+  uint8_t attempt = 1;
+  for (; attempt <= MAX_ATTEMPTS; attempt++) {
+    drain(fd);
+    if (write(fd, command, length) != length) {
+      return 1;
+    }
+    sleep_ms(wire_time_ms(length, 9600));
+    drain(fd);
+    if (!expect_response) {
+      sleep_ms(WAKE_SETTLE_MS);
+      capture.record(elapsed_ms(harness_start), slot, 0, attempt, command, length, nullptr, 0);
+      return 0;
+    }
+
+    bool is_long = command[0] == 0xA5 && command[1] == 0xA5;
+    auto tx_end = Clock::now();
+    auto phase_start = tx_end;
+    auto last_byte = tx_end;
+    uint32_t default_timeout = is_long ? LONG_SETTLE_MS + LONG_RX_TIMEOUT_MS : SHORT_SETTLE_MS + SHORT_RX_TIMEOUT_MS;
+    double timeout = adaptive ? timing.first_byte_timeout_ms(slot, default_timeout) : default_timeout;
+    rx_transactions++;
+    while (*rx_length < MAX_FRAME_LENGTH) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      int wait_ms = 1;
+      if (rx_wait) {
+        double remaining = timeout - elapsed_ms(phase_start);
+        if (frame_state(buf, *rx_length) == FRAME_NEEDS_IDLE) {
+          remaining = std::min<double>(remaining, wire_time_ms(3, 9600));
+        }
+        wait_ms = std::max(1, static_cast<int>(remaining + 0.999));
+      }
+      uint8_t missing = frame_bytes_missing(buf, *rx_length);
+      if (rx_wait && *rx_length > 0 && missing > 1 && frame_state(buf, *rx_length) == FRAME_INCOMPLETE) {
+        // uart_read_bytes() for the rest of the frame returns once they are all in, which takes their wire time
+        sleep_ms(std::min<double>(wire_time_ms(missing, 9600), timeout - elapsed_ms(phase_start)));
+      } else {
+        poll(&pfd, 1, wait_ms);
+      }
+      rx_wakeups++;
+      uint8_t byte;
+      while (*rx_length < MAX_FRAME_LENGTH && read(fd, &byte, 1) == 1) {
+        buf[(*rx_length)++] = reverse_bits(byte);
+        last_byte = Clock::now();
+        if (*rx_length == 1) {
+          if (adaptive) {
+            timing.record_onset(slot, static_cast<uint32_t>(elapsed_ms(tx_end)));
+          }
+          phase_start = last_byte;
+          timeout = is_long ? LONG_RX_TIMEOUT_MS : SHORT_RX_TIMEOUT_MS;
+        }
+      }
+      FrameState state = frame_state(buf, *rx_length);
+      if (state == FRAME_COMPLETE ||
+          (state == FRAME_NEEDS_IDLE && elapsed_ms(last_byte) >= wire_time_ms(3, 9600))) {
+        break;
+      }
+      if (elapsed_ms(phase_start) >= timeout) {
+        break;
+      }
+    }
+    if (*rx_length > 0) {
+      break;
+    }
+    if (attempt < MAX_ATTEMPTS) {
+      sleep_ms(RETRY_DELAY_MS);
+    }
+  }
+
+  int8_t result = 0;
+  if (*rx_length < SHORT_FRAME_LENGTH) {
+    result = 1;
+  } else if (!check_crc(buf, *rx_length)) {
+    result = -1;
+  }
+  if (result != 0 && adaptive) {
+    timing.record_failure(slot);
+  }
+
+  // Trace frames hold the response as it was on the wire, like the component's ring
+  uint8_t raw[MAX_FRAME_LENGTH];
+  for (uint8_t i = 0; i < *rx_length; i++) {
+    raw[i] = reverse_bits(buf[i]);
+  }
+  capture.record(elapsed_ms(harness_start), slot, result, attempt > MAX_ATTEMPTS ? MAX_ATTEMPTS : attempt, command,
+                 length, raw, *rx_length);
+  return result;
+}
+
+uint32_t gap_ms(uint32_t configured_ms) { return adaptive ? timing.gap_ms(configured_ms) : configured_ms; }
+
+void record(Stats &stats, int8_t result, double latency_ms) {
+  stats.latencies_ms.push_back(latency_ms);
+  if (result == 0) {
+    stats.ok++;
+  } else if (result < 0) {
+    stats.crc_errors++;
+  } else {
+    stats.no_response++;
+  }
+}
+
+uint32_t now_ms() { return static_cast<uint32_t>(elapsed_ms(harness_start)); }
+
+// The poller's events, as XGTBattery logs them
+void report(uint32_t cycle, uint16_t events) {
+  // One per PollEvent bit
+  static const char *const NAMES[] = {
+      "retry",           "cells detected",    "no cell answered", "cells do not add up to the pack voltage",
+      "batch supported", "batch unsupported", "batch failed",     "pack detected",
+      "pack removed",    "weakest cell",
+  };
+  for (uint8_t bit = 0; bit < sizeof(NAMES) / sizeof(NAMES[0]); bit++) {
+    if (events & (1 << bit)) {
+      std::printf("cycle %u: %s\n", cycle, NAMES[bit]);
+    }
+  }
+}
+
+double percentile(std::vector<double> sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  std::sort(sorted.begin(), sorted.end());
+  size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+  return sorted[index];
+}
+
+void print_stats(const char *name, const Stats &stats) {
+  if (stats.latencies_ms.empty()) {
+    return;
+  }
+  double sum = 0;
+  for (double latency : stats.latencies_ms) {
+    sum += latency;
+  }
+  std::printf("%-20s n=%-5zu ok=%-5u crc=%-4u none=%-4u avg=%6.1f p50=%6.1f p99=%6.1f max=%6.1f ms\n", name,
+              stats.latencies_ms.size(), stats.ok, stats.crc_errors, stats.no_response,
+              sum / stats.latencies_ms.size(), percentile(stats.latencies_ms, 0.5),
+              percentile(stats.latencies_ms, 0.99), percentile(stats.latencies_ms, 1.0));
+
+  // 5ms buckets, last bucket collects everything above
+  const int bucket_ms = 5;
+  const int buckets = 16;
+  uint32_t counts[buckets] = {0};
+  for (double latency : stats.latencies_ms) {
+    counts[std::min(buckets - 1, static_cast<int>(latency / bucket_ms))]++;
+  }
+  for (int i = 0; i < buckets; i++) {
+    if (counts[i] == 0) {
+      continue;
+    }
+    int bar = static_cast<int>(40.0 * counts[i] / stats.latencies_ms.size()) + 1;
+    std::printf("    %3d-%-3s ms %5u %s\n", i * bucket_ms, i == buckets - 1 ? "" : std::to_string((i + 1) * bucket_ms).c_str(),
+                counts[i], std::string(bar, '#').c_str());
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  SimulatorConfig config;
+  uint32_t cycles = 20;
+  const char *capture_path = nullptr;
+  int expect_cells = -1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    const char *value = argv[i + 1];
+    if (arg == "--cycles") {
+      cycles = std::strtoul(value, nullptr, 10);
+    } else if (arg == "--delay") {
+      config.delay_ms = std::strtoul(value, nullptr, 10);
+    } else if (arg == "--jitter") {
+      config.jitter_ms = std::strtoul(value, nullptr, 10);
+    } else if (arg == "--drop") {
+      config.drop_rate = std::strtod(value, nullptr);
+    } else if (arg == "--corrupt") {
+      config.corrupt_rate = std::strtod(value, nullptr);
+    } else if (arg == "--baud") {
+      config.baud = std::strtoul(value, nullptr, 10);
+    } else if (arg == "--cells") {
+      config.cells = std::strtoul(value, nullptr, 10);
+    } else if (arg == "--adaptive") {
+      adaptive = std::strtoul(value, nullptr, 10) != 0;
+    } else if (arg == "--batch") {
+      batch = std::strtoul(value, nullptr, 10) != 0;
+    } else if (arg == "--sim-batch") {
+      config.batch = std::strtoul(value, nullptr, 10) != 0;
+    } else if (arg == "--rx-wait") {
+      rx_wait = std::strtoul(value, nullptr, 10) != 0;
+    } else if (arg == "--live") {
+      live = std::strtoul(value, nullptr, 10) != 0;
+    } else if (arg == "--capture") {
+      capture_path = value;
+    } else if (arg == "--expect-cells") {
+      expect_cells = std::strtol(value, nullptr, 10);
+    } else {
+      std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return 2;
+    }
+  }
+
+  capture.init(capture_path != nullptr ? 255 : 0);
+  BatterySimulator simulator(config);
+  if (!simulator.open()) {
+    return 1;
+  }
+  std::atomic<bool> running{true};
+  std::thread server([&] { simulator.run(running); });
+
+  int fd = open(simulator.slave_path().c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0) {
+    perror("open");
+    running = false;
+    server.join();
+    return 1;
+  }
+  struct termios tio;
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(fd, TCSANOW, &tio);
+
+  PackPoller poller;
+  poller.set_needed((1 << REG_COUNT) - 1, (1 << MAX_CELLS) - 1);
+  poller.set_class_interval(POLL_STATIC, 0);
+  poller.set_class_interval(POLL_SLOW, 0);
+  poller.set_batch_reads(batch);
+  if (live) {
+    poller.start_capture((1 << REG_PACK_VOLTAGE) | (1 << REG_TEMPERATURE), 1);
+  }
+
+  Stats stats[REG_COUNT];
+  Stats batch_stats;
+  std::vector<double> cycle_ms;
+  uint8_t buf[MAX_FRAME_LENGTH] = {0};
+  uint8_t rx_length;
+  uint32_t absent_cycles = 0;
+
+  for (uint32_t cycle = 0; cycle < cycles; cycle++) {
+    auto cycle_start = Clock::now();
+    // Like the component's capture cycles: rows skip the wake byte while the pack is awake from the previous one
+    bool woke = !live || poller.cycle_responses() == 0;
+    report(cycle, poller.begin_cycle(now_ms(), woke));
+    if (woke) {
+      transact(fd, &WAKE_BYTE, 1, AdaptiveTiming::SLOTS, false, buf, &rx_length);
+    }
+    while (const PollStep *step = poller.next()) {
+      sleep_ms(gap_ms(step->gap_ms));
+      auto start = Clock::now();
+      int8_t result = transact(fd, step->command, step->length, step->reg, true, buf, &rx_length);
+      record(step->reg < REG_COUNT ? stats[step->reg] : batch_stats, result, elapsed_ms(start));
+      report(cycle, poller.handle(result, buf, rx_length, now_ms()));
+    }
+    if (poller.cycle_responses() == 0) {
+      absent_cycles++;
+    }
+    report(cycle, poller.end_cycle(now_ms()));
+    cycle_ms.push_back(elapsed_ms(cycle_start));
+    timing.cycle_complete();
+  }
+
+  running = false;
+  server.join();
+  close(fd);
+
+  if (capture_path != nullptr) {
+    std::vector<uint8_t> blob(capture.blob_size());
+    capture.write_blob(blob.data());
+    std::ofstream(capture_path, std::ios::binary).write(reinterpret_cast<const char *>(blob.data()), blob.size());
+    std::printf("Captured %u frames to %s\n", capture.size(), capture_path);
+  }
+
+  std::printf("Simulator: %dS, delay %ums, jitter %ums, drop %.3f, corrupt %.3f, baud %u\n", config.cells,
+              config.delay_ms, config.jitter_ms, config.drop_rate, config.corrupt_rate, config.baud);
+  std::printf("Detected cells: %d, commands served: %u, cycles without a pack: %u\n", poller.cell_count(),
+              simulator.commands(), absent_cycles);
+  if (adaptive) {
+    std::printf("Adaptive timing: p99 onset %ums, first-byte timeout %ums, gap %ums (configured 50ms)\n",
+                timing.max_p99_onset_ms(), timing.first_byte_timeout_ms(REG_CELL_VOLTAGES, SHORT_SETTLE_MS + SHORT_RX_TIMEOUT_MS),
+                timing.gap_ms(50));
+  }
+  std::printf("Receive: %s, %.1f wakeups per transaction\n", rx_wait ? "wait for bytes" : "poll every 1ms",
+              rx_transactions > 0 ? static_cast<double>(rx_wakeups) / rx_transactions : 0.0);
+  std::printf("\n");
+  for (uint8_t reg = 0; reg < REG_COUNT; reg++) {
+    print_stats(REGISTERS[reg].name, stats[reg]);
+  }
+  print_stats("batch", batch_stats);
+
+  double total = 0;
+  for (double ms : cycle_ms) {
+    total += ms;
+  }
+  std::printf("\n%s: n=%zu avg=%.1f min=%.1f max=%.1f ms\n", live ? "Capture row" : "Full cycle", cycle_ms.size(),
+              total / cycle_ms.size(), percentile(cycle_ms, 0.0), percentile(cycle_ms, 1.0));
+  if (live) {
+    std::printf("Capture rate: %.1f rows/s\n", cycle_ms.size() * 1000.0 / total);
+  }
+  if (expect_cells >= 0 && (absent_cycles > 0 || poller.cell_count() != expect_cells)) {
+    std::printf("FAIL: expected the pack on every cycle with %d cells\n", expect_cells);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,209 @@
+// Replays a frame trace through the protocol core: bit reversal, framing, check_crc() and register
+// decode, exactly as the component does, and compares the outcome with the result recorded on the
+// device. Deterministic, so a field capture reproduces the same anomaly on every run.
+//   xgt_replay <capture>
+// The capture is either a binary trace blob (xgt_harness --capture) or a log containing the
+// "XGTTRACE nnn <hex>" lines printed by xgt_battery.dump_trace with format: binary.
+// Exits 1 when a replayed result differs from the recorded one.
+
+#include "xgt_protocol.h"
+#include "xgt_registers.h"
+#include "xgt_trace.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace esphome::xgt_battery;
+
+namespace {
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c = std::tolower(static_cast<unsigned char>(c));
+  return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+// Reassemble the blob from "XGTTRACE nnn <hex>" log lines, ordered by chunk number
+bool blob_from_log(const std::string &text, std::vector<uint8_t> *blob) {
+  std::map<unsigned, std::vector<uint8_t>> chunks;
+  size_t pos = 0;
+  while ((pos = text.find("XGTTRACE ", pos)) != std::string::npos) {
+    pos += 9;
+    unsigned index = std::strtoul(text.c_str() + pos, nullptr, 10);
+    pos = text.find(' ', pos);
+    if (pos == std::string::npos) {
+      break;
+    }
+    pos++;
+    std::vector<uint8_t> &chunk = chunks[index];
+    chunk.clear();
+    while (pos + 1 < text.size() && hex_value(text[pos]) >= 0 && hex_value(text[pos + 1]) >= 0) {
+      chunk.push_back(hex_value(text[pos]) << 4 | hex_value(text[pos + 1]));
+      pos += 2;
+    }
+  }
+  for (auto &entry : chunks) {
+    blob->insert(blob->end(), entry.second.begin(), entry.second.end());
+  }
+  return !chunks.empty();
+}
+
+// Table register read by an address, REG_COUNT for cells and addresses outside the table
+uint8_t table_register(const uint8_t *address) {
+  for (uint8_t reg = 0; reg < REG_CELL_VOLTAGES; reg++) {
+    uint8_t table_address[ADDRESS_LENGTH];
+    command_address(REGISTERS[reg].command, table_address);
+    if (memcmp(address, table_address, ADDRESS_LENGTH) == 0) {
+      return reg;
+    }
+  }
+  return REG_COUNT;
+}
+
+std::string hex(const uint8_t *data, uint8_t length) {
+  std::string result;
+  char byte[3];
+  for (uint8_t i = 0; i < length; i++) {
+    std::snprintf(byte, sizeof(byte), "%02X", data[i]);
+    result += byte;
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "Usage: %s <capture>\n", argv[0]);
+    return 2;
+  }
+  std::ifstream file(argv[1], std::ios::binary);
+  if (!file) {
+    std::perror(argv[1]);
+    return 2;
+  }
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  std::vector<uint8_t> blob(content.begin(), content.end());
+  if (blob.size() < sizeof(TRACE_BLOB_MAGIC) || memcmp(blob.data(), TRACE_BLOB_MAGIC, sizeof(TRACE_BLOB_MAGIC)) != 0) {
+    blob.clear();
+    if (!blob_from_log(content, &blob)) {
+      std::fprintf(stderr, "%s: neither a trace blob nor a log with XGTTRACE lines\n", argv[1]);
+      return 2;
+    }
+  }
+
+  TraceReader reader(blob.data(), blob.size());
+  if (!reader.valid()) {
+    std::fprintf(stderr, "%s: unsupported trace format\n", argv[1]);
+    return 2;
+  }
+
+  uint32_t frames = 0;
+  uint32_t results[3] = {0};  // ok, short/none, CRC
+  uint32_t mismatches = 0;
+  // Latest raw value per register, as the component keeps them: health is scaled by cell size and parallel count
+  uint16_t raw_values[REG_COUNT]{0};
+  TraceFrame frame;
+  std::printf("%10s  %-22s %3s %4s %6s  %-6s %-8s %s\n", "time_ms", "register", "try", "rec", "replay", "raw",
+              "value", "rx (wire order)");
+  while (reader.next(&frame)) {
+    frames++;
+    if (frame.tx_length <= 1) {
+      std::printf("%10u  %-22s %3u %4d\n", frame.time_ms, "wake", frame.attempts, frame.result);
+      continue;
+    }
+
+    // The component's receive path: bit reversal per byte, then the same validation
+    uint8_t buf[MAX_FRAME_LENGTH];
+    memcpy(buf, frame.rx, frame.rx_length);
+    reverse_bits(buf, frame.rx_length);
+    int8_t result = 0;
+    if (frame.rx_length < SHORT_FRAME_LENGTH) {
+      result = 1;
+    } else if (!check_crc(buf, frame.rx_length)) {
+      result = -1;
+    }
+    results[result == 0 ? 0 : result > 0 ? 1 : 2]++;
+    bool mismatch = result != frame.result;
+    mismatches += mismatch;
+
+    if (frame.reg == REG_COUNT + 1) {
+      // XGTBattery's REG_READ: read_register() or the register scan, any address or long frame type
+      char name[32];
+      if (frame.tx_length == SHORT_FRAME_LENGTH && reverse_bits(frame.tx[0]) == 0xCC) {
+        uint8_t address[ADDRESS_LENGTH];
+        command_address(frame.tx, address);
+        std::snprintf(name, sizeof(name), "read %02X %02X %02X %02X", address[0], address[1], address[2], address[3]);
+      } else {
+        std::snprintf(name, sizeof(name), "read type 0x%02X", frame.tx_length > 2 ? reverse_bits(frame.tx[2]) : 0);
+      }
+      std::string value = is_short_frame(buf, frame.rx_length) ? std::to_string(decode_le16(buf)) : "-";
+      std::printf("%10u  %-22s %3u %4d %6d  %-15s %s%s\n", frame.time_ms, name, frame.attempts, frame.result, result,
+                  value.c_str(), hex(frame.rx, frame.rx_length).c_str(), mismatch ? "  MISMATCH" : "");
+      continue;
+    }
+
+    if (frame.reg >= REG_COUNT) {
+      // Batched read: one 16-bit value per requested register, see build_batch_command()
+      uint8_t request[MAX_FRAME_LENGTH];
+      memcpy(request, frame.tx, frame.tx_length);
+      reverse_bits(request, frame.tx_length);
+      uint8_t count = long_frame_payload_length(request, frame.tx_length) / 4;
+      std::string values = "-";
+      if (result == 0 && is_batch_response(buf, frame.rx_length, count)) {
+        values.clear();
+        for (uint8_t i = 0; i < count; i++) {
+          values += (i > 0 ? "," : "") + std::to_string(buf[4 + i * 2] | (buf[5 + i * 2] << 8));
+          uint8_t reg = table_register(request + 4 + i * ADDRESS_LENGTH);
+          if (reg < REG_COUNT) {
+            uint8_t command[SHORT_FRAME_LENGTH];
+            uint8_t response[SHORT_FRAME_LENGTH];
+            build_short_command(request + 4 + i * ADDRESS_LENGTH, command);
+            batch_short_response(buf, command, i, response);
+            raw_values[reg] = REGISTERS[reg].decode(response);
+          }
+        }
+      }
+      std::string name = "batch of " + std::to_string(count);
+      std::printf("%10u  %-22s %3u %4d %6d  %-15s %s%s\n", frame.time_ms, name.c_str(), frame.attempts, frame.result,
+                  result, values.c_str(), hex(frame.rx, frame.rx_length).c_str(), mismatch ? "  MISMATCH" : "");
+      continue;
+    }
+
+    const RegisterInfo &reg = REGISTERS[frame.reg];
+    std::string name = reg.name;
+    if (frame.reg == REG_CELL_VOLTAGES && frame.tx_length == SHORT_FRAME_LENGTH) {
+      uint8_t command[SHORT_FRAME_LENGTH];
+      memcpy(command, frame.tx, SHORT_FRAME_LENGTH);
+      reverse_bits(command, SHORT_FRAME_LENGTH);
+      name += " " + std::to_string(command[4] / 2);
+    } else if (frame.tx_length != SHORT_FRAME_LENGTH || memcmp(frame.tx, reg.command, SHORT_FRAME_LENGTH) != 0) {
+      name += " (unexpected TX)";
+    }
+
+    if (is_short_frame(buf, frame.rx_length)) {  // What XGTBattery decodes a value from
+      uint16_t raw = reg.decode(buf);
+      raw_values[frame.reg] = raw;
+      std::printf("%10u  %-22s %3u %4d %6d  %-6u %-8.3f %s%s\n", frame.time_ms, name.c_str(), frame.attempts,
+                  frame.result, result, raw, register_value(frame.reg, raw_values),
+                  hex(frame.rx, frame.rx_length).c_str(), mismatch ? "  MISMATCH" : "");
+    } else {
+      std::printf("%10u  %-22s %3u %4d %6d  %-6s %-8s %s%s\n", frame.time_ms, name.c_str(), frame.attempts,
+                  frame.result, result, "-", "-", hex(frame.rx, frame.rx_length).c_str(),
+                  mismatch ? "  MISMATCH" : "");
+    }
+  }
+
+  std::printf("\n%u of %u frames replayed: %u ok, %u short/no response, %u CRC errors, %u mismatches\n", frames,
+              reader.count(), results[0], results[1], results[2], mismatches);
+  return mismatches > 0 ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+#include "xgt_sim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+namespace esphome {
+namespace xgt_battery {
+
+BatterySimulator::BatterySimulator(const SimulatorConfig &config) : config_(config), rng_(config.seed) {}
+
+BatterySimulator::~BatterySimulator() {
+  if (this->slave_fd_ >= 0) {
+    close(this->slave_fd_);
+  }
+  if (this->master_fd_ >= 0) {
+    close(this->master_fd_);
+  }
+}
+
+bool BatterySimulator::open() {
+  this->master_fd_ = posix_openpt(O_RDWR | O_NOCTTY);
+  if (this->master_fd_ < 0 || grantpt(this->master_fd_) != 0 || unlockpt(this->master_fd_) != 0) {
+    perror("posix_openpt");
+    return false;
+  }
+  this->slave_path_ = ptsname(this->master_fd_);
+
+  // Keep a slave fd open so the master never sees EIO between clients, and put the line in raw mode
+  this->slave_fd_ = ::open(this->slave_path_.c_str(), O_RDWR | O_NOCTTY);
+  if (this->slave_fd_ < 0) {
+    perror("open slave");
+    return false;
+  }
+  struct termios tio;
+  tcgetattr(this->slave_fd_, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(this->slave_fd_, TCSANOW, &tio);
+  return true;
+}
+
+void BatterySimulator::sleep_ms_(uint32_t ms) const {
+  if (ms > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+}
+
+bool BatterySimulator::value_for_(const uint8_t *command, uint16_t *value) const {
+  // Pack: 2P 4Ah cells, 42 charges, 100% health, 80% charge, 25.0 degC
+  if (memcmp(command, NUM_CHARGES_COMMAND, SHORT_FRAME_LENGTH) == 0) {
+    *value = 42;
+  } else if (memcmp(command, CELL_SIZE_COMMAND, SHORT_FRAME_LENGTH) == 0) {
+    *value = 40 << 8;  // Decoded from byte 5
+  } else if (memcmp(command, PARALLEL_COUNT_COMMAND, SHORT_FRAME_LENGTH) == 0) {
+    *value = 2;  // Decoded from byte 4
+  } else if (memcmp(command, BATTERY_HEALTH_COMMAND, SHORT_FRAME_LENGTH) == 0) {
+    *value = 8000;
+  } else if (memcmp(command, CHARGE_COMMAND, SHORT_FRAME_LENGTH) == 0) {
+    *value = 80 * 255;
+  } else if (memcmp(command, TEMPERATURE_COMMAND, SHORT_FRAME_LENGTH) == 0) {
+    *value = 2981;
+  } else if (memcmp(command, PACK_VOLTAGE_COMMAND, SHORT_FRAME_LENGTH) == 0) {
+    uint32_t pack_mv = 0;
+    for (uint8_t cell = 1; cell <= this->config_.cells; cell++) {
+      pack_mv += 3600 + cell * 5;
+    }
+    *value = pack_mv;
+  } else {
+    for (uint8_t cell = 1; cell <= 10; cell++) {
+      uint8_t cell_command[SHORT_FRAME_LENGTH];
+      build_cell_command(CELL_VOLTAGE_COMMAND, cell, cell_command);
+      if (memcmp(command, cell_command, SHORT_FRAME_LENGTH) == 0) {
+        if (cell > this->config_.cells) {
+          return false;  // Cell does not exist: no answer
+        }
+        *value = 3600 + cell * 5;
+        return true;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+void BatterySimulator::respond_(const uint8_t *command, uint16_t value) {
+  // Short response in memory order: 0xCC <crc> <command bytes 2..3> <value LE> 0x00 0x33
+  uint8_t frame[SHORT_FRAME_LENGTH] = {0xCC, 0x00, reverse_bits(command[2]), reverse_bits(command[3]),
+                                       static_cast<uint8_t>(value & 0xFF), static_cast<uint8_t>(value >> 8),
+                                       0x00, 0x33};
+  frame[1] = short_frame_checksum(frame);
+  reverse_bits(frame, SHORT_FRAME_LENGTH);
+  this->send_(frame, SHORT_FRAME_LENGTH, SHORT_FRAME_LENGTH);
+}
+
+void BatterySimulator::respond_batch_(const uint8_t *request, uint8_t length) {
+  // Memory-order request: A5 A5 BATCH_READ_REQUEST <padding> <4 address bytes per register> <sum>
+  uint8_t buf[MAX_FRAME_LENGTH];
+  memcpy(buf, request, length);
+  reverse_bits(buf, length);
+  if (!this->config_.batch || !check_crc(buf, length) || buf[2] != BATCH_READ_REQUEST) {
+    return;  // Like a pack without batch support: no answer
+  }
+  uint8_t count = long_frame_payload_length(buf, length) / 4;
+  uint8_t payload[BATCH_MAX_REGISTERS * 2];
+  for (uint8_t i = 0; i < count && i < BATCH_MAX_REGISTERS; i++) {
+    // Rebuild the short command for the register and answer it like one; unknown registers read 0
+    uint8_t command[SHORT_FRAME_LENGTH] = {0xCC, 0x00, 0, 0, 0, 0, 0x00, 0x33};
+    memcpy(command + 2, buf + 4 + i * 4, 4);
+    encode_short_command(command);
+    uint16_t value = 0;
+    if (!this->value_for_(command, &value)) {
+      value = 0;
+    }
+    payload[i * 2] = value & 0xFF;
+    payload[i * 2 + 1] = value >> 8;
+  }
+  uint8_t frame[MAX_FRAME_LENGTH];
+  uint8_t frame_length = encode_long_frame(BATCH_READ_RESPONSE, payload, count * 2, frame);
+  this->send_(frame, frame_length, length);
+}
+
+void BatterySimulator::send_(uint8_t *frame, uint8_t length, uint8_t command_length) {
+  std::uniform_real_distribution<double> chance(0.0, 1.0);
+  if (chance(this->rng_) < this->config_.corrupt_rate) {
+    std::uniform_int_distribution<int> bit(0, length * 8 - 1);
+    int flip = bit(this->rng_);
+    frame[flip / 8] ^= 1 << (flip % 8);
+  }
+
+  // The pty delivers the command instantly; on the real line the last byte lands after the wire time
+  uint32_t delay = this->config_.baud > 0 ? wire_time_ms(command_length, this->config_.baud) : 0;
+  delay += this->config_.delay_ms;
+  if (this->config_.jitter_ms > 0) {
+    std::uniform_int_distribution<uint32_t> jitter(0, this->config_.jitter_ms);
+    delay += jitter(this->rng_);
+  }
+  this->sleep_ms_(delay);
+
+  for (uint8_t i = 0; i < length; i++) {
+    if (chance(this->rng_) < this->config_.drop_rate) {
+      continue;
+    }
+    if (write(this->master_fd_, &frame[i], 1) != 1) {
+      return;
+    }
+    if (this->config_.baud > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(11000000 / this->config_.baud));
+    }
+  }
+}
+
+void BatterySimulator::run(const std::atomic<bool> &running) {
+  uint8_t buf[MAX_FRAME_LENGTH];
+  uint8_t length = 0;
+
+  while (running) {
+    // Long frames carry no length: they end when the line goes idle, like on the component side
+    bool long_frame = length > 0 && buf[0] == 0xA5;
+    struct pollfd pfd = {this->master_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, long_frame ? 5 : 10) <= 0 || !(pfd.revents & POLLIN)) {
+      if (long_frame) {
+        this->commands_++;
+        this->respond_batch_(buf, length);
+        length = 0;
+      }
+      continue;
+    }
+    uint8_t byte;
+    if (read(this->master_fd_, &byte, 1) != 1) {
+      continue;
+    }
+
+    // Commands start with 0x33 (short) or 0xA5 (long) in wire order; anything else before that
+    // (wake byte, noise) is dropped
+    if (length == 0 && byte != 0x33 && byte != 0xA5) {
+      continue;
+    }
+    if (length < MAX_FRAME_LENGTH) {
+      buf[length++] = byte;
+    }
+    if (buf[0] == 0xA5 || length < SHORT_FRAME_LENGTH) {
+      continue;
+    }
+    length = 0;
+
+    this->commands_++;
+    uint16_t value;
+    if (buf[7] == 0xCC && this->value_for_(buf, &value)) {
+      this->respond_(buf, value);
+    }
+  }
+}
+
+}  // namespace xgt_battery
+}  // namespace esphome
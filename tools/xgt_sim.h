@@ -0,0 +1,58 @@
+#pragma once
+
+// Software XGT battery on a pseudo-terminal. Answers the wake byte, the 8-byte short register
+// commands, the per-cell commands and batched long-frame reads exactly as sent by the component, with configurable response
+// delay, jitter, dropped bytes and CRC corruption.
+
+#include "xgt_protocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace esphome {
+namespace xgt_battery {
+
+struct SimulatorConfig {
+  uint32_t delay_ms{5};      // Response onset after the last command byte
+  uint32_t jitter_ms{0};     // Uniform extra delay 0..jitter_ms
+  double drop_rate{0.0};     // Probability of dropping each response byte
+  double corrupt_rate{0.0};  // Probability of flipping one bit in a response
+  uint32_t baud{9600};       // Paces response bytes like the real line, 0 = as fast as possible
+  uint8_t cells{10};         // Series cells; commands for cells above this are not answered
+  bool batch{true};          // Answer batched long-frame reads; false behaves like a pack without them
+  uint32_t seed{1};
+};
+
+class BatterySimulator {
+ public:
+  explicit BatterySimulator(const SimulatorConfig &config);
+  ~BatterySimulator();
+
+  // Create the pty pair in raw mode. Returns false on failure.
+  bool open();
+  const std::string &slave_path() const { return this->slave_path_; }
+
+  // Serve commands until running is cleared
+  void run(const std::atomic<bool> &running);
+
+  uint32_t commands() const { return this->commands_; }
+
+ protected:
+  bool value_for_(const uint8_t *command, uint16_t *value) const;
+  void respond_(const uint8_t *command, uint16_t value);
+  void respond_batch_(const uint8_t *request, uint8_t length);
+  void send_(uint8_t *frame, uint8_t length, uint8_t command_length);
+  void sleep_ms_(uint32_t ms) const;
+
+  SimulatorConfig config_;
+  int master_fd_{-1};
+  int slave_fd_{-1};
+  std::string slave_path_;
+  std::mt19937 rng_;
+  uint32_t commands_{0};
+};
+
+}  // namespace xgt_battery
+}  // namespace esphome
@@ -0,0 +1,50 @@
+// Standalone XGT battery simulator: prints the pty path to connect to and serves commands until killed.
+//   xgt_sim [--delay ms] [--jitter ms] [--drop p] [--corrupt p] [--baud b] [--cells n] [--batch 0|1] [--seed s]
+
+#include "xgt_sim.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace esphome::xgt_battery;
+
+int main(int argc, char **argv) {
+  SimulatorConfig config;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    const char *value = argv[i + 1];
+    if (arg == "--delay") {
+      config.delay_ms = std::strtoul(value, nullptr, 10);
+    } else if (arg == "--jitter") {
+      config.jitter_ms = std::strtoul(value, nullptr, 10);
+    } else if (arg == "--drop") {
+      config.drop_rate = std::strtod(value, nullptr);
+    } else if (arg == "--corrupt") {
+      config.corrupt_rate = std::strtod(value, nullptr);
+    } else if (arg == "--baud") {
+      config.baud = std::strtoul(value, nullptr, 10);
+    } else if (arg == "--cells") {
+      config.cells = std::strtoul(value, nullptr, 10);
+    } else if (arg == "--batch") {
+      config.batch = std::strtoul(value, nullptr, 10) != 0;
+    } else if (arg == "--seed") {
+      config.seed = std::strtoul(value, nullptr, 10);
+    } else {
+      std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return 2;
+    }
+  }
+
+  BatterySimulator simulator(config);
+  if (!simulator.open()) {
+    return 1;
+  }
+  std::printf("XGT battery simulator on %s (%dS, delay %ums, jitter %ums, drop %.3f, corrupt %.3f)\n",
+              simulator.slave_path().c_str(), config.cells, config.delay_ms, config.jitter_ms, config.drop_rate,
+              config.corrupt_rate);
+  std::fflush(stdout);
+
+  std::atomic<bool> running{true};
+  simulator.run(running);
+  return 0;
+}
@@ -0,0 +1,308 @@
+// Correctness checks for the host-buildable headers: bit reversal, framing, CRC, command construction and
+// decode (xgt_protocol.h), the polling cycle against a scripted pack (xgt_poller.h), the pack snapshot
+// record (xgt_snapshot.h) and the delta-encoded history store (xgt_history.h). Registered with ctest;
+// prints every failed check and exits non-zero if there was one.
+//   xgt_tests
+
+#include "xgt_history.h"
+#include "xgt_poller.h"
+#include "xgt_protocol.h"
+#include "xgt_snapshot.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace esphome::xgt_battery;
+
+namespace {
+
+int failures = 0;
+
+void expect(bool condition, const char *what) {
+  if (!condition) {
+    std::printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+// Short response carrying a little-endian value, in wire order
+void make_response(uint16_t value, uint8_t *wire) {
+  uint8_t frame[8] = {0xCC, 0x00, 0xC0, 0x03, static_cast<uint8_t>(value & 0xFF), static_cast<uint8_t>(value >> 8),
+                      0x00, 0x33};
+  frame[1] = short_frame_checksum(frame);
+  memcpy(wire, frame, sizeof(frame));
+  reverse_bits(wire, sizeof(frame));
+}
+
+// Receive path as run by XGTBattery::run_transaction(): reverse each byte on arrival,
+// stop at frame completion, then validate and decode
+bool parse(const uint8_t *wire, uint8_t length, float *value) {
+  uint8_t buf[MAX_FRAME_LENGTH]{0};
+  uint8_t rx_length = 0;
+  while (rx_length < length) {
+    buf[rx_length] = reverse_bits(wire[rx_length]);
+    rx_length++;
+    if (frame_state(buf, rx_length) == FRAME_COMPLETE) {
+      break;
+    }
+  }
+  if (!is_short_frame(buf, rx_length) || !check_crc(buf, rx_length)) {
+    return false;
+  }
+  *value = scale_raw(decode_le16(buf), 0.001f, 0.0f);
+  return true;
+}
+
+void protocol_checks() {
+  // Bit reversal
+  expect(reverse_bits(0x33) == 0xCC, "reverse_bits(0x33)");
+  expect(reverse_bits(0x01) == 0x80, "reverse_bits(0x01)");
+  for (int i = 0; i < 256; i++) {
+    if (reverse_bits(reverse_bits(i)) != i) {
+      expect(false, "reverse_bits round trip");
+      break;
+    }
+  }
+
+  // Cell commands match the lookup-table construction used by the original implementation
+  static const uint8_t LOOKUP[16] = {0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe, 0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf};
+  for (uint8_t cell = 1; cell <= 10; cell++) {
+    uint8_t legacy[8];
+    memcpy(legacy, CELL_VOLTAGE_COMMAND, 8);
+    legacy[4] = (LOOKUP[cell * 2 & 0b1111] << 4) | (LOOKUP[cell * 2 >> 4]);
+    legacy[1] = (LOOKUP[(cell * 2 + 194) & 0b1111] << 4) | (LOOKUP[(cell * 2 + 194) >> 4]);
+    uint8_t built[8];
+    build_cell_command(CELL_VOLTAGE_COMMAND, cell, built);
+    expect(memcmp(legacy, built, 8) == 0, "build_cell_command matches legacy construction");
+  }
+
+  // Short response round trip and CRC rejection
+  uint8_t wire[8];
+  float value = 0;
+  make_response(36120, wire);
+  expect(parse(wire, 8, &value) && value > 36.119f && value < 36.121f, "decode pack voltage response");
+  wire[5] ^= 0x10;
+  expect(!parse(wire, 8, &value), "corrupted response fails CRC");
+
+  // Framing: short frame completes on its 8th byte only when terminated by 0x33
+  uint8_t frame[8] = {0xCC, 0, 0, 0, 0, 0, 0, 0x33};
+  expect(frame_state(frame, 7) == FRAME_INCOMPLETE, "7 bytes of short frame incomplete");
+  expect(frame_state(frame, 8) == FRAME_COMPLETE, "8 bytes of short frame complete");
+  frame[7] = 0x00;
+  expect(frame_state(frame, 8) == FRAME_INCOMPLETE, "short frame without terminator");
+
+  // Long frame: 16-bit sum over bytes 2..n-3, padding count in byte 3
+  uint8_t long_frame[12] = {0xA5, 0xA5, 0x10, 0x02, 0x01, 0x02, 0x03, 0x04, 0x00, 0x00, 0xFF, 0xFF};
+  uint16_t sum = 0;
+  for (int i = 2; i < 8; i++) {
+    sum += long_frame[i];
+  }
+  long_frame[8] = sum >> 8;
+  long_frame[9] = sum & 0xFF;
+  expect(frame_state(long_frame, 7) == FRAME_INCOMPLETE, "long frame header only");
+  expect(frame_state(long_frame, 12) == FRAME_NEEDS_IDLE, "long frame waits for idle");
+  expect(check_crc(long_frame, 12), "long frame CRC");
+
+  // Receptions cut short or run on by a noisy line: nothing read past length, no length underflow
+  uint8_t response[9];
+  make_response(3600, response);
+  reverse_bits(response, 8);
+  response[8] = 0x00;
+  expect(check_crc(response, 8) && is_short_frame(response, 8), "short response CRC");
+  expect(!check_crc(response, 9) && !is_short_frame(response, 9), "short response with a trailing byte");
+  expect(!check_crc(response, 7), "short response without terminator");
+  uint8_t padded[6] = {0xA5, 0xA5, 0x90, 0x0F, 0x00, 0x9F};  // Sum fits, 15 padding bytes announced
+  expect(!check_crc(padded, 6), "long frame shorter than its padding");
+  expect(long_frame_payload_length(padded, 6) == 0, "payload of long frame shorter than its padding");
+  expect(!check_crc(long_frame, 5), "long frame shorter than its header and checksum");
+
+  // Health: raw / (cell size * parallel), fallback when metadata is missing
+  expect(battery_health(8000, 40, 2) == 100, "battery health");
+  expect(battery_health(255, 0, 0) == 100, "battery health fallback");
+}
+
+void builder_checks() {
+  // Every table command is its register address, framed; cells differ in address byte 2
+  // (CELL_VOLTAGE_COMMAND is only a base and carries cell 1's checksum)
+  const uint8_t *const commands[] = {NUM_CHARGES_COMMAND,    CELL_SIZE_COMMAND, PARALLEL_COUNT_COMMAND,
+                                     BATTERY_HEALTH_COMMAND, CHARGE_COMMAND,    TEMPERATURE_COMMAND,
+                                     PACK_VOLTAGE_COMMAND};
+  bool rebuilt_all = true;
+  for (const uint8_t *command : commands) {
+    uint8_t address[ADDRESS_LENGTH];
+    uint8_t rebuilt[SHORT_FRAME_LENGTH];
+    command_address(command, address);
+    build_short_command(address, rebuilt);
+    rebuilt_all &= memcmp(rebuilt, command, SHORT_FRAME_LENGTH) == 0;
+  }
+  expect(rebuilt_all, "table commands rebuilt from their addresses");
+  uint8_t address[ADDRESS_LENGTH];
+  uint8_t cell_command[SHORT_FRAME_LENGTH];
+  build_cell_command(CELL_VOLTAGE_COMMAND, 3, cell_command);
+  command_address(cell_command, address);
+  expect(address[0] == 0xC0 && address[1] == 0x03 && address[2] == 6 && address[3] == 0, "cell 3 address");
+  reverse_bits(cell_command, SHORT_FRAME_LENGTH);
+  expect(check_crc(cell_command, SHORT_FRAME_LENGTH), "built command passes check_crc");
+}
+
+// Runs cycles of poller against a pack with cells series cells that answers short reads only (cells = 0:
+// no pack), with silent_cell and silent_reg not answering on the first cycle. Returns the commands sent.
+uint32_t run_cycles(PackPoller &poller, uint8_t cells, uint32_t cycles, uint8_t silent_cell = 0,
+                    uint8_t silent_reg = REG_COUNT) {
+  uint32_t commands = 0;
+  for (uint32_t cycle = 0; cycle < cycles; cycle++) {
+    uint32_t now = cycle * 10000;
+    poller.begin_cycle(now, true);
+    while (const PollStep *step = poller.next()) {
+      uint8_t buf[SHORT_FRAME_LENGTH];
+      uint8_t length = 0;
+      bool answers = step->reg < REG_CELL_VOLTAGES || (step->reg == REG_CELL_VOLTAGES && step->cell <= cells &&
+                                                       (cycle > 0 || step->cell != silent_cell));
+      answers &= cycle > 0 || step->reg != silent_reg;
+      if (cells > 0 && answers) {
+        make_response(step->reg == REG_PACK_VOLTAGE ? cells * 3600 : 3600, buf);
+        reverse_bits(buf, SHORT_FRAME_LENGTH);
+        length = SHORT_FRAME_LENGTH;
+      }
+      poller.handle(length > 0 ? 0 : 1, buf, length, now + 100);
+      commands++;
+    }
+    poller.end_cycle(now + 1000);
+  }
+  return commands;
+}
+
+void poller_checks() {
+  // batch_reads on a pack without batch support: the silent batch is no presence probe
+  PackPoller poller;
+  poller.set_needed((1 << REG_COUNT) - 1, (1 << MAX_CELLS) - 1);
+  poller.set_batch_reads(true);
+  run_cycles(poller, 4, 3);
+  expect(poller.pack_present() && poller.absent_cycles() == 0, "pack without batch support is present");
+  expect(poller.cell_count() == 4, "pack without batch support gets its cells detected");
+  expect(poller.good_registers() == (1 << REG_CELL_VOLTAGES) - 1 && poller.good_cells() == 0x0F,
+         "pack without batch support is read");
+
+  // Pack swapped for a smaller one: nothing of the old pack stays valid
+  run_cycles(poller, 0, 1);
+  expect(poller.good_registers() == 0 && poller.good_cells() == 0 && poller.last_good(REG_CHARGE) == 0 &&
+             poller.decoded_registers() == 0,
+         "removed pack leaves no valid values");
+  run_cycles(poller, 3, 1);
+  expect(poller.cell_count() == 3 && poller.good_cells() == 0x07, "new pack only has its own cells valid");
+  expect(poller.decoded_registers() == (1 << REG_CELL_VOLTAGES) - 1, "new pack has its registers decoded");
+
+  // Only cells needed: the pack voltage is read anyway while the count is unknown, so a dropped cell answer
+  // cannot cut the count short
+  PackPoller cells_only;
+  cells_only.set_needed(1 << REG_CELL_VOLTAGES, (1 << MAX_CELLS) - 1);
+  run_cycles(cells_only, 5, 1, 4);
+  expect(cells_only.cell_count() == 0 && cells_only.detect_count() == 3, "cell count cut short is rejected");
+  run_cycles(cells_only, 5, 1);
+  expect(cells_only.cell_count() == 5, "cell count detected on the next cycle");
+
+  // A static register that failed when the pack was detected is read again next cycle, not after static_interval
+  PackPoller missed;
+  missed.set_needed((1 << REG_COUNT) - 1, (1 << MAX_CELLS) - 1);
+  run_cycles(missed, 4, 2, 0, REG_PARALLEL_COUNT);
+  expect(missed.good_registers() & (1 << REG_PARALLEL_COUNT), "failed static register is read on the next cycle");
+
+  // Only a slow register: cycles between its reads send nothing and leave the pack present
+  PackPoller slow_only;
+  slow_only.set_needed(1 << REG_TEMPERATURE, 0);
+  expect(run_cycles(slow_only, 4, 4) == 1, "slow register is read once per slow_interval");
+  expect(slow_only.pack_present() && slow_only.absent_cycles() == 0, "cycle with nothing due keeps presence");
+  // Presence only: the probe answers for it on every cycle
+  PackPoller probe_only;
+  probe_only.set_needed(0, 0);
+  probe_only.set_presence_probe(true);
+  expect(run_cycles(probe_only, 4, 3) == 3 && probe_only.pack_present(), "presence probe on every cycle");
+  run_cycles(probe_only, 0, 1);
+  expect(!probe_only.pack_present(), "presence probe sees the pack removed");
+
+  // No pack: the batch and one short command, then the cycle ends
+  PackPoller empty;
+  empty.set_needed((1 << REG_COUNT) - 1, (1 << MAX_CELLS) - 1);
+  empty.set_batch_reads(true);
+  expect(run_cycles(empty, 0, 2) == 4, "cycle without a pack ends after the probe");
+  expect(!empty.pack_present() && empty.absent_cycles() == 2, "cycle without a pack is absent");
+}
+
+void snapshot_checks() {
+  // Ages round up and saturate instead of wrapping
+  PackSnapshot snapshot{};
+  snapshot.time_ms = 10000;
+  snapshot.register_age_s[0] = PackSnapshot::age_s(10000, 7001);
+  expect(snapshot.register_age_s[0] == 3, "snapshot age rounds up");
+  expect(PackSnapshot::age_s(10000, 10000) == 0, "snapshot age of a value read at the end of the cycle");
+  expect(PackSnapshot::age_s(100000000, 0) == UINT16_MAX, "snapshot age saturates");
+  expect(snapshot.register_age_ms(0, 12500) == 5500, "snapshot age at publish time");
+}
+
+// A day of 10s cycles on a drifting 5S pack, removed for a while and replaced by a 10S one
+void history_checks() {
+  History history;
+  history.init(240, 240, 90);
+  std::vector<HistorySample> raw;
+  uint16_t mv[HISTORY_CHANNELS] = {0};
+  srand(1);
+  for (uint32_t i = 0; i < 24 * 360; i++) {
+    if (i >= 11 * 360 && i < 12 * 360) {
+      continue;  // Not recorded while the pack is absent
+    }
+    HistorySample sample{i * 10000, 0, {0}};
+    uint8_t cells = i < 12 * 360 ? 5 : 10;
+    for (uint8_t ch = 0; ch < cells; ch++) {
+      mv[ch] = mv[ch] == 0 ? 3600 + ch * 7 : mv[ch] + rand() % 7 - 3;
+      sample.values[ch] = mv[ch];
+      sample.valid |= 1 << ch;
+    }
+    uint16_t pack = 0;
+    for (uint8_t ch = 0; ch < cells; ch++) {
+      pack += mv[ch];
+    }
+    sample.values[HISTORY_PACK_VOLTAGE] = pack + rand() % 20;
+    sample.values[HISTORY_TEMPERATURE] = 2981 + rand() % 3;
+    sample.valid |= 1 << HISTORY_PACK_VOLTAGE | 1 << HISTORY_TEMPERATURE;
+    history.add(sample);
+    raw.push_back(sample);
+  }
+
+  // Read through a copy, as the web handler does
+  HistoryTier tier;
+  tier.copy_from(history.tier(0));
+  expect(tier.size() == history.tier(0).size() && tier.size() >= 240,
+         "history keeps the configured number of samples");
+  size_t index = raw.size() - tier.size();
+  bool exact = true;
+  tier.for_each([&](const HistorySample &sample) {
+    const HistorySample &expected = raw[index++];
+    exact &= sample.time_ms == expected.time_ms && sample.valid == expected.valid;
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+      exact &= !(expected.valid & (1 << ch)) || sample.values[ch] == expected.values[ch];
+    }
+  });
+  expect(exact, "history round trip through a copy is lossless");
+  expect(history.tier(1).size() >= 240 && history.tier(2).size() >= 90, "history downsampled tiers filled");
+
+  size_t plain = (history.tier(0).size() + history.tier(1).size() + history.tier(2).size()) * sizeof(HistorySample);
+  std::printf("history: %zu bytes for %u + %u + %u samples (%zu bytes as plain samples)\n", history.memory_size(),
+              history.tier(0).size(), history.tier(1).size(), history.tier(2).size(), plain);
+}
+
+}  // namespace
+
+int main() {
+  protocol_checks();
+  builder_checks();
+  poller_checks();
+  snapshot_checks();
+  history_checks();
+  if (failures > 0) {
+    std::printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  std::printf("All checks passed\n");
+  return 0;
+}